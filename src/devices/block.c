@@ -19,6 +19,16 @@ struct block
 
     unsigned long long read_cnt;        /**< Number of sectors read. */
     unsigned long long write_cnt;       /**< Number of sectors written. */
+
+    /* Requests satisfied by a cache layered on the device. */
+    unsigned long long cache_lookups;   /**< Sector reads asked of the cache. */
+    unsigned long long cache_hits;      /**< ...that found the sector cached. */
+    unsigned long long cache_writes;    /**< Sector writes made to the cache. */
+
+    /* Head movement, for devices where seeks cost time. */
+    block_sector_t next_sector;         /**< Sector after the last accessed. */
+    unsigned long long seek_cnt;        /**< Non-sequential accesses. */
+    unsigned long long seek_distance;   /**< Total sectors skipped by them. */
   };
 
 /** List of all block devices. */
@@ -113,6 +123,21 @@ check_sector (struct block *block, block_sector_t sector)
     }
 }
 
+/** Notes an access to SECTOR on BLOCK, counting a seek if it
+   does not follow the previous access. */
+static void
+note_access (struct block *block, block_sector_t sector)
+{
+  if (sector != block->next_sector)
+    {
+      block->seek_cnt++;
+      block->seek_distance += (sector > block->next_sector
+                               ? sector - block->next_sector
+                               : block->next_sector - sector);
+    }
+  block->next_sector = sector + 1;
+}
+
 /** Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -121,6 +146,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
+  note_access (block, sector);
   block->ops->read (block->aux, sector, buffer);
   block->read_cnt++;
 }
@@ -135,10 +161,29 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  note_access (block, sector);
   block->ops->write (block->aux, sector, buffer);
   block->write_cnt++;
 }
 
+/** Notes that a cache layered on BLOCK was asked for a sector's
+   data, which it already held if HIT is true. */
+void
+block_note_cache_read (struct block *block, bool hit)
+{
+  block->cache_lookups++;
+  if (hit)
+    block->cache_hits++;
+}
+
+/** Notes that a cache layered on BLOCK took a sector write, which
+   it may later pass on to the device or combine with others. */
+void
+block_note_cache_write (struct block *block)
+{
+  block->cache_writes++;
+}
+
 /** Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -160,6 +205,14 @@ block_type (struct block *block)
   return block->type;
 }
 
+/** Returns how many of REQUESTED sector transfers never reached
+   the device, given that it did PERFORMED of them. */
+static unsigned long long
+saved (unsigned long long requested, unsigned long long performed)
+{
+  return requested > performed ? requested - performed : 0;
+}
+
 /** Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -174,6 +227,19 @@ block_print_stats (void)
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
                   block->read_cnt, block->write_cnt);
+          if (block->cache_lookups > 0 || block->cache_writes > 0)
+            printf ("%s (%s): cache hit %llu of %llu reads (%llu%%), "
+                    "saved %llu reads, %llu writes\n",
+                    block->name, block_type_name (block->type),
+                    block->cache_hits, block->cache_lookups,
+                    block->cache_lookups > 0
+                    ? block->cache_hits * 100 / block->cache_lookups : 0,
+                    saved (block->cache_lookups, block->read_cnt),
+                    saved (block->cache_writes, block->write_cnt));
+          if (block->seek_cnt > 0)
+            printf ("%s (%s): %llu seeks, %llu sectors apart on average\n",
+                    block->name, block_type_name (block->type),
+                    block->seek_cnt, block->seek_distance / block->seek_cnt);
         }
     }
 }
@@ -200,6 +266,12 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->cache_lookups = 0;
+  block->cache_hits = 0;
+  block->cache_writes = 0;
+  block->next_sector = 0;
+  block->seek_cnt = 0;
+  block->seek_distance = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <stdbool.h>
 
 /** Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -58,6 +59,8 @@ enum block_type block_type (struct block *);
 
 /** Statistics. */
 void block_print_stats (void);
+void block_note_cache_read (struct block *, bool hit);
+void block_note_cache_write (struct block *);
 
 /** Lower-level interface to block device drivers. */
 
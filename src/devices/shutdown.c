@@ -11,7 +11,18 @@
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/dcache.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
 #endif
 
 /** Keyboard control register port. */
@@ -132,10 +143,21 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  inode_print_stats ();
+  dir_print_stats ();
+  dcache_print_stats ();
+  journal_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  page_print_stats ();
+  swap_print_stats ();
+  zswap_print_stats ();
+  ksm_print_stats ();
+#endif
 }
@@ -17,8 +17,11 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/** Number of timer ticks since OS booted. */
+/** Number of timer ticks since OS booted.  It takes two
+   instructions to read, so `ticks_seqlock' tells readers whether
+   the timer interrupt changed it in between. */
 static int64_t ticks;
+static struct seqlock ticks_seqlock;
 
 /** Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -36,6 +39,7 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  seqlock_init (&ticks_seqlock);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -70,9 +74,15 @@ timer_calibrate (void)
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  do
+    {
+      seq = seqlock_read_begin (&ticks_seqlock);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seqlock, seq));
   return t;
 }
 
@@ -170,7 +180,9 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  seqlock_write_begin (&ticks_seqlock);
   ticks++;
+  seqlock_write_end (&ticks_seqlock);
   thread_tick ();
 }
 
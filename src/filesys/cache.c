@@ -0,0 +1,487 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <hash.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/** Buffer cache.
+
+   Every access to the file system device goes through a cache of
+   CACHE_CNT sectors.  A sector is read from the device only the
+   first time it is needed, and a write only marks the cached copy
+   dirty.  Dirty sectors reach the device when they are evicted,
+   when cache_flush() or cache_write_back() is called, or when
+   they have been dirty for cache_dirty_age milliseconds,
+   whichever comes first.
+
+   A caller locks the sector it wants with cache_lock(), which
+   brings the sector into the cache if it is not already there,
+   then uses cache_read() or cache_zero() to get at its data,
+   cache_dirty() if it modified them, and finally cache_unlock().
+
+   `cache_sync' protects `cache_index' and, in each block, `sector',
+   `users', and `accessed'.  A block's own lock protects its data,
+   `up_to_date', and `dirty'.  A block with nonzero `users' is
+   never evicted or given to another sector.  Only clean blocks are
+   given to another sector: a dirty victim is written back first,
+   under its old sector number, so that no one can read a stale
+   copy of the sector from the device in the meantime.
+
+   cache_read_ahead() queues a sector to be brought into the cache
+   by a background thread, so that a reader can work on the
+   sectors it has while the next ones are read.
+
+   A block marked dirty with cache_journal() instead of
+   cache_dirty() belongs to the journal's running transaction
+   (see journal.c).  It is not written back to its own sector
+   until the transaction commits, at which point the journal calls
+   cache_checkpoint().  Before then, writing it back puts it in
+   the journal's log, and reading it again reads it from there.
+
+   A flusher thread wakes up every FLUSH_INTERVAL_MS, commits the
+   journal's running transaction if it is older than
+   cache_dirty_age, and writes back the sectors that have been
+   dirty too long, which bounds how much data a crash can lose.
+   If more than DIRTY_RATIO percent of the cache is dirty,
+   cache_throttle() makes writers write back dirty sectors
+   themselves, so that they cannot dirty data faster than the
+   disk takes it.  Sectors written back together are written in
+   ascending order, to keep seeks short. */
+
+/** Number of cached sectors. */
+#define CACHE_CNT 64
+
+/** A cached sector. */
+struct cache_block
+  {
+    struct lock lock;           /**< Protects the data. */
+    block_sector_t sector;      /**< Sector number, or INVALID_SECTOR. */
+    struct hash_elem hash_elem; /**< `cache_index' element. */
+    int users;                  /**< Threads holding or awaiting `lock'. */
+    bool accessed;              /**< Used since the clock last passed? */
+    bool up_to_date;            /**< Data read from disk or zeroed? */
+    bool dirty;                 /**< Data changed since written back? */
+    bool journaled;             /**< In the running transaction? */
+    int64_t dirty_since;        /**< Timer tick when made dirty. */
+    uint8_t data[BLOCK_SECTOR_SIZE]; /**< Sector data. */
+  };
+
+#define INVALID_SECTOR ((block_sector_t) -1)
+
+static struct cache_block cache[CACHE_CNT];
+static struct hash cache_index; /**< Cached blocks, by sector number. */
+static struct lock cache_sync;  /**< Protects `cache_index'. */
+static struct condition block_unused; /**< Some block's `users' hit 0. */
+static size_t hand;             /**< Clock hand. */
+static size_t dirty_cnt;        /**< Dirty blocks, protected by `cache_sync'. */
+
+/** -wb-age: Milliseconds a sector may stay dirty. */
+unsigned cache_dirty_age = 2000;
+
+#define FLUSH_INTERVAL_MS 500   /**< Flusher's sleep between passes. */
+#define DIRTY_RATIO 50          /**< Percent of cache dirty to throttle. */
+
+/** Sectors queued for read-ahead. */
+#define RA_QUEUE_CNT 32
+static block_sector_t ra_queue[RA_QUEUE_CNT];
+static size_t ra_head;          /**< Index of first queued sector. */
+static size_t ra_cnt;           /**< Number of queued sectors. */
+static struct lock ra_lock;     /**< Protects the queue. */
+static struct condition ra_ready; /**< Signaled when `ra_cnt' > 0. */
+
+static thread_func read_ahead_daemon;
+static thread_func flush_daemon;
+
+static hash_hash_func block_hash;
+static hash_less_func block_less;
+
+/** Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  lock_init (&cache_sync);
+  cond_init (&block_unused);
+  hash_init (&cache_index, block_hash, block_less, NULL);
+  for (i = 0; i < CACHE_CNT; i++)
+    {
+      struct cache_block *b = &cache[i];
+      lock_init (&b->lock);
+      b->sector = INVALID_SECTOR;
+      b->users = 0;
+      b->accessed = false;
+      b->up_to_date = false;
+      b->dirty = false;
+      b->journaled = false;
+    }
+
+  lock_init (&ra_lock);
+  cond_init (&ra_ready);
+  thread_create ("read-ahead", PRI_DEFAULT, read_ahead_daemon, NULL);
+  thread_create ("flusher", PRI_DEFAULT, flush_daemon, NULL);
+}
+
+/** Writes locked block B to disk if it is dirty: to its own
+   sector, or to the journal's log if it is in the running
+   transaction. */
+static void
+write_back (struct cache_block *b)
+{
+  ASSERT (lock_held_by_current_thread (&b->lock));
+  if (b->dirty)
+    {
+      block_write (fs_device,
+                   b->journaled ? journal_log_slot (b->sector) : b->sector,
+                   b->data);
+      b->dirty = false;
+
+      lock_acquire (&cache_sync);
+      dirty_cnt--;
+      lock_release (&cache_sync);
+    }
+}
+
+/** Writes back every block that has been dirty for at least
+   MIN_AGE timer ticks, in ascending sector order, except blocks
+   in the running transaction, which the journal takes care of. */
+static void
+write_behind (int64_t min_age)
+{
+  struct cache_block *dirty[CACHE_CNT];
+  size_t cnt = 0;
+  size_t i;
+
+  lock_acquire (&cache_sync);
+  for (i = 0; i < CACHE_CNT; i++)
+    {
+      struct cache_block *b = &cache[i];
+
+      /* Without B's lock, `dirty' and `dirty_since' may be out of
+         date.  At worst we skip B, or write back a clean block,
+         which does nothing. */
+      if (b->dirty && !b->journaled
+          && timer_elapsed (b->dirty_since) >= min_age)
+        {
+          size_t j;
+
+          b->users++;
+          for (j = cnt++; j > 0 && dirty[j - 1]->sector > b->sector; j--)
+            dirty[j] = dirty[j - 1];
+          dirty[j] = b;
+        }
+    }
+  lock_release (&cache_sync);
+
+  for (i = 0; i < cnt; i++)
+    {
+      lock_acquire (&dirty[i]->lock);
+      write_back (dirty[i]);
+      cache_unlock (dirty[i]);
+    }
+}
+
+/** Writes every dirty block outside the running transaction to
+   disk. */
+void
+cache_flush (void)
+{
+  write_behind (0);
+}
+
+/** Returns the block that caches SECTOR, or a null pointer if
+   there is none. */
+static struct cache_block *
+lookup (block_sector_t sector)
+{
+  struct cache_block key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&cache_sync));
+  key.sector = sector;
+  e = hash_find (&cache_index, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct cache_block, hash_elem) : NULL;
+}
+
+/** Runs the clock and returns a block without users that has not
+   been used since the hand last passed it, or a null pointer if
+   every block is in use. */
+static struct cache_block *
+choose_victim (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_sync));
+  for (i = 0; i < 2 * CACHE_CNT; i++)
+    {
+      struct cache_block *b = &cache[hand];
+      if (++hand >= CACHE_CNT)
+        hand = 0;
+
+      if (b->users > 0)
+        continue;
+      if (b->accessed)
+        b->accessed = false;
+      else
+        return b;
+    }
+  return NULL;
+}
+
+/** Locks and returns the cache block for SECTOR, bringing it into
+   the cache if necessary.  Its data are not read from disk until
+   cache_read() is called. */
+struct cache_block *
+cache_lock (block_sector_t sector)
+{
+  struct cache_block *b;
+
+  lock_acquire (&cache_sync);
+  for (;;)
+    {
+      b = lookup (sector);
+      if (b != NULL)
+        break;
+
+      b = choose_victim ();
+      if (b == NULL)
+        cond_wait (&block_unused, &cache_sync);
+      else if (b->dirty)
+        {
+          /* Write the victim back, then look again.  Someone else
+             may have used it or brought SECTOR in meanwhile. */
+          b->users++;
+          lock_release (&cache_sync);
+
+          lock_acquire (&b->lock);
+          write_back (b);
+          lock_release (&b->lock);
+
+          lock_acquire (&cache_sync);
+          if (--b->users == 0)
+            cond_broadcast (&block_unused, &cache_sync);
+        }
+      else
+        {
+          if (b->sector != INVALID_SECTOR)
+            hash_delete (&cache_index, &b->hash_elem);
+          b->sector = sector;
+          b->up_to_date = false;
+          b->journaled = false;
+          hash_insert (&cache_index, &b->hash_elem);
+          break;
+        }
+    }
+  b->users++;
+  b->accessed = true;
+  lock_release (&cache_sync);
+
+  lock_acquire (&b->lock);
+  return b;
+}
+
+/** Reads locked block B's data from disk, unless they are
+   already up to date. */
+static void
+load (struct cache_block *b)
+{
+  ASSERT (lock_held_by_current_thread (&b->lock));
+  if (!b->up_to_date)
+    {
+      block_read (fs_device, journal_read_slot (b->sector), b->data);
+      b->up_to_date = true;
+    }
+}
+
+/** Returns the data of locked block B, reading them from disk if
+   necessary. */
+void *
+cache_read (struct cache_block *b)
+{
+  block_note_cache_read (fs_device, b->up_to_date);
+  load (b);
+  return b->data;
+}
+
+/** Zeros the data of locked block B, without reading them from
+   disk, marks B dirty, and returns its data. */
+void *
+cache_zero (struct cache_block *b)
+{
+  ASSERT (lock_held_by_current_thread (&b->lock));
+  memset (b->data, 0, BLOCK_SECTOR_SIZE);
+  b->up_to_date = true;
+  cache_dirty (b);
+  return b->data;
+}
+
+/** Marks locked block B dirty, so that it will be written back to
+   disk. */
+void
+cache_dirty (struct cache_block *b)
+{
+  ASSERT (lock_held_by_current_thread (&b->lock));
+  ASSERT (b->up_to_date);
+  block_note_cache_write (fs_device);
+  if (!b->dirty)
+    {
+      b->dirty = true;
+      b->dirty_since = timer_ticks ();
+
+      lock_acquire (&cache_sync);
+      dirty_cnt++;
+      lock_release (&cache_sync);
+    }
+}
+
+/** Marks locked block B dirty, like cache_dirty(), as part of the
+   journal's running transaction. */
+void
+cache_journal (struct cache_block *b)
+{
+  cache_dirty (b);
+  if (!b->journaled)
+    {
+      journal_add (b->sector);
+      b->journaled = true;
+    }
+}
+
+/** Unlocks block B, which the caller must not use afterward. */
+void
+cache_unlock (struct cache_block *b)
+{
+  lock_release (&b->lock);
+
+  lock_acquire (&cache_sync);
+  if (--b->users == 0)
+    cond_broadcast (&block_unused, &cache_sync);
+  lock_release (&cache_sync);
+}
+
+/** Writes SECTOR back to disk now, if it is cached and dirty. */
+void
+cache_write_back (block_sector_t sector)
+{
+  struct cache_block *b;
+
+  lock_acquire (&cache_sync);
+  b = lookup (sector);
+  if (b != NULL)
+    b->users++;
+  lock_release (&cache_sync);
+
+  if (b != NULL)
+    {
+      lock_acquire (&b->lock);
+      write_back (b);
+      cache_unlock (b);
+    }
+}
+
+/** Writes SECTOR, which the journal has committed, to its own
+   sector, reading it back from the log first if it was evicted. */
+void
+cache_checkpoint (block_sector_t sector)
+{
+  struct cache_block *b = cache_lock (sector);
+
+  load (b);
+  b->journaled = false;
+  if (b->dirty)
+    write_back (b);
+  else
+    block_write (fs_device, sector, b->data);
+  cache_unlock (b);
+}
+
+/** If too much of the cache is dirty, writes back dirty blocks
+   before returning, to hold writers to the disk's pace.  The
+   caller must not hold any block locked. */
+void
+cache_throttle (void)
+{
+  bool over;
+
+  lock_acquire (&cache_sync);
+  over = dirty_cnt * 100 > CACHE_CNT * DIRTY_RATIO;
+  lock_release (&cache_sync);
+
+  if (over)
+    write_behind (0);
+}
+
+/** Queues SECTOR to be read into the cache in the background.
+   Does nothing if the queue is full: read-ahead is only a hint. */
+void
+cache_read_ahead (block_sector_t sector)
+{
+  lock_acquire (&ra_lock);
+  if (ra_cnt < RA_QUEUE_CNT)
+    {
+      ra_queue[(ra_head + ra_cnt++) % RA_QUEUE_CNT] = sector;
+      cond_signal (&ra_ready, &ra_lock);
+    }
+  lock_release (&ra_lock);
+}
+
+/** Read-ahead thread.  Brings queued sectors into the cache. */
+static void
+read_ahead_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      block_sector_t sector;
+      struct cache_block *b;
+
+      lock_acquire (&ra_lock);
+      while (ra_cnt == 0)
+        cond_wait (&ra_ready, &ra_lock);
+      sector = ra_queue[ra_head];
+      ra_head = (ra_head + 1) % RA_QUEUE_CNT;
+      ra_cnt--;
+      lock_release (&ra_lock);
+
+      b = cache_lock (sector);
+      load (b);
+      cache_unlock (b);
+    }
+}
+
+/** Flusher thread.  Commits the journal's running transaction and
+   writes back blocks once they are older than cache_dirty_age. */
+static void
+flush_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      int64_t age = (int64_t) cache_dirty_age * TIMER_FREQ / 1000;
+
+      timer_msleep (FLUSH_INTERVAL_MS);
+      journal_commit_old (age);
+      write_behind (age);
+    }
+}
+
+/** Returns the hash value for cache block E. */
+static unsigned
+block_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct cache_block *b = hash_entry (e, struct cache_block, hash_elem);
+  return hash_int (b->sector);
+}
+
+/** Returns true if cache block A_ caches a lower sector than B_. */
+static bool
+block_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct cache_block *a = hash_entry (a_, struct cache_block, hash_elem);
+  const struct cache_block *b = hash_entry (b_, struct cache_block, hash_elem);
+
+  return a->sector < b->sector;
+}
@@ -0,0 +1,25 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include "devices/block.h"
+
+struct cache_block;
+
+extern unsigned cache_dirty_age;
+
+void cache_init (void);
+void cache_flush (void);
+void cache_write_back (block_sector_t);
+void cache_checkpoint (block_sector_t);
+void cache_throttle (void);
+
+struct cache_block *cache_lock (block_sector_t);
+void *cache_read (struct cache_block *);
+void *cache_zero (struct cache_block *);
+void cache_dirty (struct cache_block *);
+void cache_journal (struct cache_block *);
+void cache_unlock (struct cache_block *);
+
+void cache_read_ahead (block_sector_t);
+
+#endif /**< filesys/cache.h */
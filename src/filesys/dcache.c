@@ -0,0 +1,167 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/** Directory entry cache.
+
+   Remembers, for the DCACHE_CNT names most recently looked up,
+   which inode sector each name maps to in its directory, so that
+   looking up the same name again does not read the directory.  A
+   name that was not found is remembered too, as DCACHE_ABSENT, so
+   that opening a missing file is just as cheap.
+
+   The directory code keeps the cache up to date: dir_add() and
+   dir_remove() record the new state of each name they change.
+   When the cache is full, the least recently used entry makes
+   room for a new one. */
+
+#define DCACHE_CNT 128
+
+/** A cached directory entry. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /**< `dcache_index' element. */
+    struct list_elem lru_elem;          /**< `lru' element. */
+    block_sector_t dir;                 /**< Directory's inode sector. */
+    char name[NAME_MAX + 1];            /**< Name within directory. */
+    block_sector_t inode_sector;        /**< Inode, or DCACHE_ABSENT. */
+  };
+
+static struct dentry dentries[DCACHE_CNT];
+static struct hash dcache_index; /**< Cached entries, by directory and name. */
+static struct list lru;         /**< All entries, most recently used first. */
+static struct lock dcache_lock; /**< Protects all of the above. */
+
+/** Statistics. */
+static unsigned long long hit_cnt;      /**< Lookups answered. */
+static unsigned long long absent_cnt;   /**< ...of those, negatively. */
+static unsigned long long miss_cnt;     /**< Lookups not answered. */
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/** Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  lock_init (&dcache_lock);
+  hash_init (&dcache_index, dentry_hash, dentry_less, NULL);
+  list_init (&lru);
+  for (i = 0; i < DCACHE_CNT; i++)
+    {
+      dentries[i].name[0] = '\0';
+      list_push_back (&lru, &dentries[i].lru_elem);
+    }
+}
+
+/** Returns the cached entry for NAME in the directory whose inode
+   is in sector DIR, or a null pointer if there is none.  The
+   caller must hold `dcache_lock'. */
+static struct dentry *
+find (block_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache_index, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/** Looks up NAME in the directory whose inode is in sector DIR.
+   If the cache knows about NAME, returns true and stores its
+   inode sector, or DCACHE_ABSENT if it does not exist, into
+   *INODE_SECTOR.  Otherwise, returns false. */
+bool
+dcache_lookup (block_sector_t dir, const char *name,
+               block_sector_t *inode_sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    {
+      list_remove (&d->lru_elem);
+      list_push_front (&lru, &d->lru_elem);
+      *inode_sector = d->inode_sector;
+      hit_cnt++;
+      if (d->inode_sector == DCACHE_ABSENT)
+        absent_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/** Records that NAME, in the directory whose inode is in sector
+   DIR, has its inode in INODE_SECTOR, or does not exist if
+   INODE_SECTOR is DCACHE_ABSENT. */
+void
+dcache_insert (block_sector_t dir, const char *name,
+               block_sector_t inode_sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d == NULL)
+    {
+      /* Reuse the least recently used entry. */
+      d = list_entry (list_back (&lru), struct dentry, lru_elem);
+      if (d->name[0] != '\0')
+        hash_delete (&dcache_index, &d->hash_elem);
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dcache_index, &d->hash_elem);
+    }
+  d->inode_sector = inode_sector;
+  list_remove (&d->lru_elem);
+  list_push_front (&lru, &d->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/** Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dentry cache: %llu hits (%llu negative), %llu misses\n",
+          hit_cnt, absent_cnt, miss_cnt);
+}
+
+/** Returns the hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/** Returns true if dentry A_ precedes dentry B_. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
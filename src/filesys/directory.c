@@ -1,10 +1,14 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /** A directory. */
 struct dir 
@@ -21,12 +25,64 @@ struct dir_entry
     bool in_use;                        /**< In use or free? */
   };
 
+/** Directory layout.  A directory is a hash table of buckets,
+   one per sector.  A name is stored in the bucket its hash selects
+   or, if that bucket is full, in the first bucket after it with a
+   free slot.  Each bucket counts the entries that passed it over
+   this way, so a lookup can stop at the first bucket that has
+   none.  When the directory becomes more than 3/4 full, it doubles
+   its number of buckets and rehashes its entries, up to
+   DIR_MAX_BUCKETS buckets, past which it just fills up.  A lookup
+   thus usually reads a single sector, however large the
+   directory.
+   A bucket that was never written is a hole in the directory's
+   inode, which reads as an empty bucket.
+
+   Adding or removing a name writes several buckets, and growing
+   rewrites them all, so each directory has a readers-writer lock,
+   its inode's inode_dir_lock(), that changes hold for writing
+   and lookups for reading.  Lookups in one directory thus run at
+   the same time, and changes to different directories too.  A
+   change must run inside a journal operation (see
+   filesys/journal.c), so that it never waits for a commit while
+   holding the lock. */
+#define BUCKET_ENTRIES 25
+
+/** A hash bucket.  Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct bucket
+  {
+    struct dir_entry entries[BUCKET_ENTRIES]; /**< Entries. */
+    uint32_t passed_cnt;                /**< Entries stored past here. */
+    uint32_t entry_cnt;                 /**< Entries in the directory,
+                                           in bucket 0 only. */
+    uint8_t unused[4];                  /**< Not used. */
+  };
+
+/** Statistics.  Lookups run in parallel, so each counts its own
+   and adds them in under `stats_lock'. */
+static struct lock stats_lock;          /**< Protects the rest. */
+static unsigned long long lookup_cnt;   /**< Name lookups. */
+static unsigned long long lookup_entries; /**< Total directory size. */
+static unsigned long long lookup_buckets; /**< Buckets read for them. */
+
+/** Initializes the directory module. */
+void
+dir_init (void) 
+{
+  lock_init (&stats_lock);
+}
+
 /** Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (block_sector_t sector, size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  size_t buckets = DIV_ROUND_UP (entry_cnt * 4 / 3, BUCKET_ENTRIES);
+
+  ASSERT (sizeof (struct bucket) == BLOCK_SECTOR_SIZE);
+  if (buckets == 0)
+    buckets = 1;
+  return inode_create (sector, buckets * BLOCK_SECTOR_SIZE);
 }
 
 /** Opens and returns the directory for the given INODE, of which
@@ -37,6 +93,7 @@ dir_open (struct inode *inode)
   struct dir *dir = calloc (1, sizeof *dir);
   if (inode != NULL && dir != NULL)
     {
+      inode_set_metadata (inode);
       dir->inode = inode;
       dir->pos = 0;
       return dir;
@@ -83,6 +140,58 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
+/** Returns the number of buckets in DIR. */
+static size_t
+bucket_cnt (const struct dir *dir) 
+{
+  return inode_length (dir->inode) / BLOCK_SECTOR_SIZE;
+}
+
+/** Returns the bucket in which NAME belongs, in a directory with
+   CNT buckets. */
+static size_t
+bucket_of (const char *name, size_t cnt) 
+{
+  return hash_string (name) % cnt;
+}
+
+/** Reads bucket IDX of DIR into *B. */
+static bool
+read_bucket (const struct dir *dir, size_t idx, struct bucket *b) 
+{
+  return inode_read_at (dir->inode, b, sizeof *b,
+                        idx * BLOCK_SECTOR_SIZE) == sizeof *b;
+}
+
+/** Writes *B to bucket IDX of DIR. */
+static bool
+write_bucket (struct dir *dir, size_t idx, const struct bucket *b) 
+{
+  return inode_write_at (dir->inode, b, sizeof *b,
+                         idx * BLOCK_SECTOR_SIZE) == sizeof *b;
+}
+
+/** Returns the number of entries in DIR. */
+static uint32_t
+get_entry_cnt (const struct dir *dir) 
+{
+  uint32_t entry_cnt;
+
+  inode_read_at (dir->inode, &entry_cnt, sizeof entry_cnt,
+                 offsetof (struct bucket, entry_cnt));
+  return entry_cnt;
+}
+
+/** Adds DELTA to the number of entries recorded in DIR. */
+static void
+add_entry_cnt (struct dir *dir, int delta) 
+{
+  uint32_t entry_cnt = get_entry_cnt (dir) + delta;
+
+  inode_write_at (dir->inode, &entry_cnt, sizeof entry_cnt,
+                  offsetof (struct bucket, entry_cnt));
+}
+
 /** Searches DIR for a file with the given NAME.
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
@@ -92,25 +201,152 @@ static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
-  struct dir_entry e;
-  size_t ofs;
+  struct bucket b;
+  size_t cnt, start, i;
+  uint32_t entry_cnt;
+  unsigned buckets = 0;
+  bool found = false;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
-      {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
-      }
+  cnt = bucket_cnt (dir);
+  start = bucket_of (name, cnt);
+  entry_cnt = get_entry_cnt (dir);
+  for (i = 0; i < cnt && !found; i++) 
+    {
+      size_t idx = (start + i) % cnt;
+      size_t j;
+
+      if (!read_bucket (dir, idx, &b))
+        break;
+      buckets++;
+
+      for (j = 0; j < BUCKET_ENTRIES; j++) 
+        {
+          struct dir_entry *e = &b.entries[j];
+          if (e->in_use && !strcmp (name, e->name)) 
+            {
+              if (ep != NULL)
+                *ep = *e;
+              if (ofsp != NULL)
+                *ofsp = idx * BLOCK_SECTOR_SIZE + j * sizeof *e;
+              found = true;
+              break;
+            }
+        }
+      if (b.passed_cnt == 0)
+        break;
+    }
+
+  lock_acquire (&stats_lock);
+  lookup_cnt++;
+  lookup_entries += entry_cnt;
+  lookup_buckets += buckets;
+  lock_release (&stats_lock);
+  return found;
+}
+
+/** Stores E in DIR, in the first bucket with a free slot starting
+   from the one E's name hashes to.  Does not update the number of
+   entries in DIR.  Returns true if successful, false if DIR is
+   full or on a disk error. */
+static bool
+insert (struct dir *dir, const struct dir_entry *e) 
+{
+  struct bucket b;
+  size_t cnt = bucket_cnt (dir);
+  size_t start = bucket_of (e->name, cnt);
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      size_t idx = (start + i) % cnt;
+      size_t j;
+
+      if (!read_bucket (dir, idx, &b))
+        return false;
+      for (j = 0; j < BUCKET_ENTRIES; j++)
+        if (!b.entries[j].in_use) 
+          {
+            b.entries[j] = *e;
+            return write_bucket (dir, idx, &b);
+          }
+
+      /* Full.  Note that E passes this bucket over. */
+      b.passed_cnt++;
+      if (!write_bucket (dir, idx, &b))
+        return false;
+    }
   return false;
 }
 
+/** Doubles the number of buckets in DIR and rehashes its entries
+   into them.  Returns true if successful, false if memory or disk
+   space runs out, in which case DIR is unchanged. */
+static bool
+grow (struct dir *dir) 
+{
+  size_t old_cnt = bucket_cnt (dir);
+  size_t new_cnt = old_cnt * 2;
+  struct dir_entry *entries;
+  struct bucket b;
+  size_t entry_cnt = 0;
+  size_t i, j;
+
+  entries = malloc (old_cnt * BUCKET_ENTRIES * sizeof *entries);
+  if (entries == NULL)
+    return false;
+
+  /* Allocate all the buckets before changing anything, so that
+     running out of disk space leaves DIR intact. */
+  if (!inode_reserve (dir->inode, new_cnt * BLOCK_SECTOR_SIZE))
+    {
+      free (entries);
+      return false;
+    }
+
+  /* Gather up the entries and empty the buckets.  With all the
+     sectors allocated, the writes cannot fail. */
+  for (i = 0; i < old_cnt; i++) 
+    {
+      read_bucket (dir, i, &b);
+      for (j = 0; j < BUCKET_ENTRIES; j++)
+        if (b.entries[j].in_use)
+          entries[entry_cnt++] = b.entries[j];
+    }
+  memset (&b, 0, sizeof b);
+  for (i = 0; i < new_cnt; i++)
+    write_bucket (dir, i, &b);
+
+  /* Rehash.  There is room for every entry. */
+  for (i = 0; i < entry_cnt; i++)
+    insert (dir, &entries[i]);
+  add_entry_cnt (dir, entry_cnt);
+  free (entries);
+  return true;
+}
+
+/** Returns the inode sector of the file named NAME in DIR, or
+   DCACHE_ABSENT if there is none, consulting the directory entry
+   cache before DIR itself. */
+static block_sector_t
+lookup_cached (const struct dir *dir, const char *name) 
+{
+  block_sector_t dir_sector = inode_get_inumber (dir->inode);
+  block_sector_t inode_sector;
+
+  if (!dcache_lookup (dir_sector, name, &inode_sector)) 
+    {
+      struct dir_entry e;
+
+      inode_sector = (lookup (dir, name, &e, NULL)
+                      ? e.inode_sector : DCACHE_ABSENT);
+      dcache_insert (dir_sector, name, inode_sector);
+    }
+  return inode_sector;
+}
+
 /** Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
@@ -119,15 +355,20 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
-  struct dir_entry e;
+  block_sector_t inode_sector;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  /* Open the inode before letting go of the directory, so that
+     the file cannot be removed and its inode freed in between. */
+  rwlock_acquire_read (inode_dir_lock (dir->inode));
+  inode_sector = lookup_cached (dir, name);
+  if (inode_sector != DCACHE_ABSENT)
+    *inode = inode_open (inode_sector);
   else
     *inode = NULL;
+  rwlock_release_read (inode_dir_lock (dir->inode));
 
   return *inode != NULL;
 }
@@ -142,7 +383,6 @@ bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
   struct dir_entry e;
-  off_t ofs;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -152,32 +392,56 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  rwlock_acquire_write (inode_dir_lock (dir->inode));
+
   /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
+  if (lookup_cached (dir, name) != DCACHE_ABSENT)
     goto done;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  /* Make room if the directory would become more than 3/4 full. */
+  if ((get_entry_cnt (dir) + 1) * 4 > bucket_cnt (dir) * BUCKET_ENTRIES * 3
+      && bucket_cnt (dir) * 2 <= DIR_MAX_BUCKETS
+      && !grow (dir))
+    goto done;
 
   /* Write slot. */
+  memset (&e, 0, sizeof e);
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  success = insert (dir, &e);
+  if (success) 
+    {
+      add_entry_cnt (dir, 1);
+      dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
+    }
 
  done:
+  rwlock_release_write (inode_dir_lock (dir->inode));
   return success;
 }
 
+/** Undoes the passed-over counts that an entry for NAME, which
+   was stored in bucket IDX of DIR, left in the buckets before
+   it. */
+static void
+unpass (struct dir *dir, const char *name, size_t idx) 
+{
+  size_t cnt = bucket_cnt (dir);
+  size_t i;
+
+  for (i = bucket_of (name, cnt); i != idx; i = (i + 1) % cnt) 
+    {
+      uint32_t passed_cnt;
+      off_t ofs = (i * BLOCK_SECTOR_SIZE
+                   + offsetof (struct bucket, passed_cnt));
+
+      inode_read_at (dir->inode, &passed_cnt, sizeof passed_cnt, ofs);
+      passed_cnt--;
+      inode_write_at (dir->inode, &passed_cnt, sizeof passed_cnt, ofs);
+    }
+}
+
 /** Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
    which occurs only if there is no file with the given NAME. */
@@ -192,6 +456,8 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  rwlock_acquire_write (inode_dir_lock (dir->inode));
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -205,12 +471,16 @@ dir_remove (struct dir *dir, const char *name)
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
+  add_entry_cnt (dir, -1);
+  unpass (dir, name, ofs / BLOCK_SECTOR_SIZE);
+  dcache_insert (inode_get_inumber (dir->inode), name, DCACHE_ABSENT);
 
   /* Remove inode. */
   inode_remove (inode);
   success = true;
 
  done:
+  rwlock_release_write (inode_dir_lock (dir->inode));
   inode_close (inode);
   return success;
 }
@@ -222,15 +492,43 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool found = false;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  rwlock_acquire_read (inode_dir_lock (dir->inode));
+  while (!found)
     {
+      /* Skip from the end of one bucket's entries to the next. */
+      if ((size_t) (dir->pos % BLOCK_SECTOR_SIZE)
+          >= BUCKET_ENTRIES * sizeof e)
+        dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+
+      if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+        break;
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          found = true;
         } 
     }
-  return false;
+  rwlock_release_read (inode_dir_lock (dir->inode));
+  return found;
+}
+
+/** Prints directory statistics. */
+void
+dir_print_stats (void) 
+{
+  unsigned long long cnt, entries, buckets;
+
+  lock_acquire (&stats_lock);
+  cnt = lookup_cnt;
+  entries = lookup_entries;
+  buckets = lookup_buckets;
+  lock_release (&stats_lock);
+
+  if (cnt > 0)
+    printf ("Directories: %llu lookups in %llu entries on average, "
+            "%llu.%02llu buckets read per lookup\n",
+            cnt, entries / cnt, buckets / cnt, buckets * 100 / cnt % 100);
 }
@@ -11,9 +11,21 @@
    retained, but much longer full path names must be allowed. */
 #define NAME_MAX 14
 
+/** Most buckets, of one sector each, that a directory grows to.
+   Growing rewrites every bucket in one journal operation, which
+   must fit in the journal's log. */
+#define DIR_MAX_BUCKETS 64
+
+/** Sectors that dir_add() or dir_remove() changes, at most: every
+   bucket, the directory's inode and extent blocks, and a new
+   file's inode.  The journal operation around either must
+   reserve this many (see filesys/journal.h). */
+#define DIR_CHANGE_CNT (DIR_MAX_BUCKETS + 8)
+
 struct inode;
 
 /** Opening and closing directories. */
+void dir_init (void);
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
 struct dir *dir_open_root (void);
@@ -26,5 +38,6 @@ bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+void dir_print_stats (void);
 
 #endif /**< filesys/directory.h */
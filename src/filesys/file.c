@@ -1,5 +1,6 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "filesys/journal.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
@@ -9,8 +10,17 @@ struct file
     struct inode *inode;        /**< File's inode. */
     off_t pos;                  /**< Current position. */
     bool deny_write;            /**< Has file_deny_write() been called? */
+
+    /* Read-ahead for file_read(). */
+    off_t ra_next;              /**< Where a sequential read would start. */
+    off_t ra_end;               /**< End of data already read ahead. */
+    int ra_window;              /**< Sectors to read ahead, 0 if none. */
   };
 
+/** Bounds on the read-ahead window, in sectors. */
+#define RA_MIN_SECTORS 4
+#define RA_MAX_SECTORS 16
+
 /** Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -60,6 +70,41 @@ file_get_inode (struct file *file)
   return file->inode;
 }
 
+/** Adjusts FILE's read-ahead window after a file_read() of the
+   bytes from START to END, and starts reading the window beyond
+   END.  A read that starts where the previous one ended is taken
+   as a sign of streaming and doubles the window; any other read
+   halves it. */
+static void
+read_ahead (struct file *file, off_t start, off_t end)
+{
+  off_t limit;
+
+  if (start == file->ra_next)
+    {
+      file->ra_window = (file->ra_window == 0 ? RA_MIN_SECTORS
+                         : file->ra_window * 2);
+      if (file->ra_window > RA_MAX_SECTORS)
+        file->ra_window = RA_MAX_SECTORS;
+    }
+  else
+    {
+      file->ra_window /= 2;
+      file->ra_end = end;
+    }
+  file->ra_next = end;
+  if (file->ra_end < end)
+    file->ra_end = end;
+
+  /* Only read what earlier calls have not already asked for. */
+  limit = end + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (file->ra_end < limit)
+    {
+      inode_read_ahead (file->inode, limit - file->ra_end, file->ra_end);
+      file->ra_end = limit;
+    }
+}
+
 /** Reads SIZE bytes from FILE into BUFFER,
    starting at the file's current position.
    Returns the number of bytes actually read,
@@ -68,8 +113,10 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
+  off_t start = file->pos;
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
+  read_ahead (file, start, file->pos);
   return bytes_read;
 }
 
@@ -87,9 +134,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /** Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file extends the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -102,9 +148,8 @@ file_write (struct file *file, const void *buffer, off_t size)
 /** Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file extends the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -113,6 +158,16 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/** Writes FILE's data that are still only in the buffer cache
+   to disk, after committing the journal, which gets the file's
+   metadata and the free map there. */
+void
+file_sync (struct file *file) 
+{
+  journal_commit ();
+  inode_sync (file->inode);
+}
+
 /** Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -2,9 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
 
 /** Partition that contains the file system. */
@@ -21,8 +24,12 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
+  dcache_init ();
+  dir_init ();
   inode_init ();
   free_map_init ();
+  journal_init (format);
 
   if (format) 
     do_format ();
@@ -36,8 +43,18 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  journal_commit ();
+  cache_flush ();
 }
 
+/** Returns the sector of DIR's inode.  New files' inodes are
+   allocated near it. */
+static block_sector_t
+dir_sector (struct dir *dir) 
+{
+  return inode_get_inumber (dir_get_inode (dir));
+}
+
 /** Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
@@ -46,14 +63,19 @@ bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir;
+  bool success;
+
+  journal_begin_cnt (DIR_CHANGE_CNT);
+  dir = dir_open_root ();
+  success = (dir != NULL
+             && free_map_allocate (1, dir_sector (dir), &inode_sector)
+             && inode_create (inode_sector, initial_size)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  journal_end ();
 
   return success;
 }
@@ -83,9 +105,14 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  struct dir *dir;
+  bool success;
+
+  journal_begin_cnt (DIR_CHANGE_CNT);
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
+  journal_end ();
 
   return success;
 }
@@ -99,5 +126,9 @@ do_format (void)
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
+
+  /* Get the new file system onto disk before anything else. */
+  cache_flush ();
+  journal_commit ();
   printf ("done.\n");
 }
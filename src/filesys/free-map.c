@@ -1,52 +1,251 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/** The free map file is not rewritten on every change.  Instead,
+   the free map remembers which of the file's sectors hold changed
+   bits, and free_map_flush() writes just those into the file, by
+   way of the buffer cache.  The journal calls it as part of each
+   commit, so that the free map on disk always matches the
+   inodes committed along with it.
+
+   For the same reason, sectors released are not reused until
+   the next commit.  Until then, the committed file system still
+   has them in use, and a crash would bring them back, so they
+   must keep their contents.
+
+   The disk is divided into allocation groups of GROUP_SECTORS
+   sectors, and the free map counts the free sectors in each.  An
+   allocation takes a goal sector, which callers set to just past
+   a file's last data or its inode, or to its directory's inode
+   for a new inode.  If the goal is free, the allocation takes it,
+   so a file that grows by itself stays contiguous.  Otherwise, it
+   looks for an empty window of WINDOW_SECTORS aligned sectors,
+   from the goal onward in the goal's group and then in the
+   following groups, skipping those without enough free sectors.
+   Starting in an empty window leaves the file room to grow in
+   place even when other files grow at the same time.  Only if no
+   window is free does an allocation take the first free run
+   anywhere. */
 
 static struct file *free_map_file;   /**< Free map file. */
 static struct bitmap *free_map;      /**< Free map, one bit per sector. */
+static struct bitmap *dirty_sectors; /**< Free map file sectors changed. */
+static struct bitmap *released;      /**< Sectors to free at next flush. */
+static size_t *group_free;           /**< Free sectors in each group. */
+static struct lock free_map_lock;    /**< Protects the above. */
+
+/** Sectors per allocation group. */
+#define GROUP_SECTORS 1024
+
+/** Sectors per window. */
+#define WINDOW_SECTORS 16
+
+/** Bits of the free map stored in each sector of its file. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+/** Notes that the CNT bits starting at SECTOR in the free map have
+   changed.  The caller must hold `free_map_lock'. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first = sector / BITS_PER_SECTOR;
+  size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+  bitmap_set_multiple (dirty_sectors, first, last - first + 1, true);
+}
+
+/** Returns the number of allocation groups. */
+static size_t
+group_cnt (void) 
+{
+  return DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+}
+
+/** Returns the sector just past the end of group GROUP. */
+static size_t
+group_end (size_t group) 
+{
+  size_t end = (group + 1) * GROUP_SECTORS;
+  return end < bitmap_size (free_map) ? end : bitmap_size (free_map);
+}
+
+/** Counts the free sectors in each group. */
+static void
+count_free (void) 
+{
+  size_t group;
+
+  for (group = 0; group < group_cnt (); group++)
+    group_free[group] = bitmap_count (free_map, group * GROUP_SECTORS,
+                                      group_end (group)
+                                      - group * GROUP_SECTORS, false);
+}
+
+/** Marks the CNT sectors starting at SECTOR as used if USED is
+   true or free if it is false, and updates the groups' free
+   counts and the dirty sectors to match.  The caller must hold
+   `free_map_lock'. */
+static void
+set_sectors (block_sector_t sector, size_t cnt, bool used) 
+{
+  size_t ofs = sector;
+  size_t end = sector + cnt;
+
+  bitmap_set_multiple (free_map, sector, cnt, used);
+  mark_dirty (sector, cnt);
+  while (ofs < end)
+    {
+      size_t group = ofs / GROUP_SECTORS;
+      size_t n = (group_end (group) < end ? group_end (group) : end) - ofs;
+      if (used)
+        group_free[group] -= n;
+      else
+        group_free[group] += n;
+      ofs += n;
+    }
+}
+
+/** Returns the first sector of a run of CNT free sectors that
+   starts between START and END, or BITMAP_ERROR if there is
+   none. */
+static size_t
+scan (size_t start, size_t end, size_t cnt) 
+{
+  size_t idx = bitmap_scan (free_map, start, cnt, false);
+  return idx < end ? idx : BITMAP_ERROR;
+}
+
+/** Returns the first sector of a free run of CNT sectors, rounded
+   up to whole windows, that starts at a window boundary between
+   START and END, or BITMAP_ERROR if there is none. */
+static size_t
+scan_windows (size_t start, size_t end, size_t cnt) 
+{
+  size_t need = ROUND_UP (cnt, WINDOW_SECTORS);
+  size_t w;
+
+  for (w = ROUND_UP (start, WINDOW_SECTORS);
+       w < end && w + need <= bitmap_size (free_map); w += WINDOW_SECTORS)
+    if (bitmap_none (free_map, w, need))
+      return w;
+  return BITMAP_ERROR;
+}
 
 /** Initializes the free map. */
 void
 free_map_init (void) 
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, journal_sectors (), true);
+  released = bitmap_create (bitmap_size (free_map));
+  dirty_sectors = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                               BLOCK_SECTOR_SIZE));
+  if (released == NULL || dirty_sectors == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  group_free = malloc (group_cnt () * sizeof *group_free);
+  if (group_free == NULL)
+    PANIC ("group allocation failed--file system device is too large");
+  count_free ();
 }
 
-/** Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+/** Allocates CNT consecutive sectors from the free map, as close
+   after sector GOAL as possible, and stores the first into
+   *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available. */
 bool
-free_map_allocate (size_t cnt, block_sector_t *sectorp)
+free_map_allocate (size_t cnt, block_sector_t goal, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  size_t first_group, i;
+  size_t sector = BITMAP_ERROR;
+
+  lock_acquire (&free_map_lock);
+  if (goal + cnt <= bitmap_size (free_map)
+      && bitmap_none (free_map, goal, cnt))
+    sector = goal;
+  if (goal >= bitmap_size (free_map))
+    goal = 0;
+  first_group = goal / GROUP_SECTORS;
+  for (i = 0; i < group_cnt () && sector == BITMAP_ERROR; i++)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      size_t group = (first_group + i) % group_cnt ();
+      size_t start = group * GROUP_SECTORS;
+
+      /* A run longer than a group may start in any group. */
+      if (cnt <= GROUP_SECTORS && group_free[group] < cnt)
+        continue;
+      if (i == 0)
+        sector = scan_windows (goal, group_end (group), cnt);
+      if (sector == BITMAP_ERROR)
+        sector = scan_windows (start, group_end (group), cnt);
     }
+  if (sector == BITMAP_ERROR)
+    sector = scan (0, bitmap_size (free_map), cnt);
+  if (sector != BITMAP_ERROR)
+    set_sectors (sector, cnt, true);
+  lock_release (&free_map_lock);
+
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
-/** Makes CNT sectors starting at SECTOR available for use. */
+/** Makes CNT sectors starting at SECTOR available for use, as of
+   the next free_map_flush(). */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  ASSERT (bitmap_none (released, sector, cnt));
+  bitmap_set_multiple (released, sector, cnt, true);
+  lock_release (&free_map_lock);
+}
+
+/** Frees the sectors released since the last flush, then writes
+   the changed parts of the free map to its file.  Called by the
+   journal as part of a commit, and at shutdown. */
+void
+free_map_flush (void) 
+{
+  size_t size = bitmap_size (released);
+  size_t i = 0;
+
+  journal_begin ();
+  lock_acquire (&free_map_lock);
+  while ((i = bitmap_scan (released, i, 1, true)) < size)
+    {
+      size_t end = bitmap_scan (released, i, 1, false);
+      if (end > size)
+        end = size;
+      bitmap_set_multiple (released, i, end - i, false);
+      set_sectors (i, end - i, false);
+      i = end;
+    }
+
+  if (free_map_file != NULL)
+    for (i = 0; i < bitmap_size (dirty_sectors); i++)
+      if (bitmap_test (dirty_sectors, i))
+        {
+          if (!bitmap_write_range (free_map, free_map_file,
+                                   i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE))
+            PANIC ("can't write free map");
+          bitmap_reset (dirty_sectors, i);
+        }
+  lock_release (&free_map_lock);
+  journal_end ();
 }
 
 /** Opens the free map file and reads it from disk. */
@@ -56,15 +255,19 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  count_free ();
 }
 
 /** Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) 
 {
+  free_map_flush ();
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /** Creates a new free map file on disk and writes the free map to
@@ -72,14 +275,22 @@ free_map_close (void)
 void
 free_map_create (void) 
 {
+  struct file *file;
+
   /* Create inode. */
   if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
     PANIC ("free map creation failed");
 
-  /* Write bitmap to file. */
-  free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
-  if (free_map_file == NULL)
+  /* Write bitmap to file.  The file becomes the free map's only
+     afterward, because allocating its sectors may commit the
+     journal, and free_map_flush() must not write to the file
+     from within the write. */
+  file = file_open (inode_open (FREE_MAP_SECTOR));
+  if (file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_write (free_map, free_map_file))
+  inode_set_metadata (file_get_inode (file));
+  if (!bitmap_write (free_map, file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty_sectors, false);
+  free_map_file = file;
 }
@@ -1,143 +1,739 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
-/** Identifies an inode. */
+/** Identifies an inode in the indexed format. */
 #define INODE_MAGIC 0x494e4f44
 
+/** Identifies an inode in the extent format. */
+#define EXTENT_MAGIC 0x45585445
+
+/** Identifies an inode that holds its data inline. */
+#define INLINE_MAGIC 0x494e4c4e
+
+/** -extents: Create new inodes in the extent format? */
+bool inode_use_extents;
+
+/** -no-inline: Store small files' data in their inodes? */
+bool inode_use_inline = true;
+
+/** Index layout.  The first DIRECT_CNT sector pointers in an
+   inode point to data sectors, the next INDIRECT_CNT to indirect
+   blocks, each holding PTRS_PER_SECTOR pointers to data sectors,
+   and the last DBL_INDIRECT_CNT to doubly indirect blocks, which
+   point to indirect blocks.  A pointer of 0 means that no sector
+   has been allocated yet: sector 0 holds the free map inode, so
+   no file can own it.  Such a hole in a file reads as zeros, and
+   a sector is allocated for it only when it is written. */
+#define DIRECT_CNT 124
+#define INDIRECT_CNT 1
+#define DBL_INDIRECT_CNT 1
+#define SECTOR_CNT (DIRECT_CNT + INDIRECT_CNT + DBL_INDIRECT_CNT)
+
+/** Sector pointers per index block. */
+#define PTRS_PER_SECTOR ((off_t) (BLOCK_SECTOR_SIZE / sizeof (block_sector_t)))
+
+/** Maximum length of an inode, in bytes. */
+#define INODE_SPAN ((DIRECT_CNT                                              \
+                     + PTRS_PER_SECTOR * INDIRECT_CNT                        \
+                     + PTRS_PER_SECTOR * PTRS_PER_SECTOR * DBL_INDIRECT_CNT) \
+                    * BLOCK_SECTOR_SIZE)
+
 /** On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t start;               /**< First data sector. */
+    block_sector_t sectors[SECTOR_CNT]; /**< Data and index sectors,
+                                           or a struct extent_map. */
     off_t length;                       /**< File size in bytes. */
     unsigned magic;                     /**< Magic number. */
-    uint32_t unused[125];               /**< Not used. */
   };
 
-/** Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
-{
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
-}
+/** Extent layout.  An inode in the extent format describes its
+   data as runs of consecutive sectors.  The first EXTENT_CNT
+   extents are kept in the inode, in the space that the indexed
+   format uses for sector pointers, and the rest in a chain of
+   extent blocks that have the same layout, ended by a null
+   `next' pointer.  (The free map's inode is sector 0, but it is
+   never an extent block.)  Extents are kept in file order, so
+   that a lookup is a binary search within each map, and the
+   sectors between them are holes.  A large file written
+   sequentially needs only a few extents, all of them in the
+   inode. */
+#define EXTENT_CNT 41
+
+/** Inline layout.  A file of at most INLINE_MAX bytes keeps its
+   data in its inode, in the space that the other formats use for
+   sector pointers or extents, so that opening and reading it
+   takes a single sector.  The data are journaled with the inode.
+   When the file grows past INLINE_MAX bytes, its data move to a
+   sector of their own and the inode takes the format that new
+   inodes get. */
+#define INLINE_MAX ((off_t) sizeof ((struct inode_disk *) 0)->sectors)
 
-/** In-memory inode. */
+/** CNT sectors of a file, starting at sector FILE_SECTOR within
+   the file, stored at consecutive disk sectors from START. */
+struct extent
+  {
+    uint32_t file_sector;               /**< First sector within file. */
+    block_sector_t start;               /**< First disk sector. */
+    uint32_t cnt;                       /**< Number of sectors. */
+  };
+
+/** Extents, at the start of an inode or an extent block. */
+struct extent_map
+  {
+    struct extent extents[EXTENT_CNT];  /**< Extents, in file order. */
+    uint32_t extent_cnt;                /**< Number of extents in use. */
+    block_sector_t next;                /**< Next extent block, or 0. */
+  };
+
+/** In-memory inode.
+
+   `open_inodes_lock' protects `open_cnt' and `removed'.  `rwlock'
+   protects the inode's data and the sectors that index them, and
+   the members after it.  Reading takes `rwlock' for reading, so
+   that any number of threads read a file at once, and writing,
+   which may allocate sectors or change the format, takes it for
+   writing.  Threads that use different files never wait for one
+   another here.
+
+   A thread waiting for `rwlock' must not be in a journal
+   operation, because the thread that holds it may be waiting for
+   a commit, which waits for every operation to end.  The one
+   exception is a directory's inode, which only a thread holding
+   the directory's `dir_lock' writes, and then always inside a
+   journal operation that keeps it from waiting for a commit. */
 struct inode 
   {
-    struct list_elem elem;              /**< Element in inode list. */
+    struct hash_elem hash_elem;         /**< `open_inodes' element. */
     block_sector_t sector;              /**< Sector number of disk location. */
     int open_cnt;                       /**< Number of openers. */
     bool removed;                       /**< True if deleted, false otherwise. */
+    struct rwlock rwlock;               /**< Protects data and below. */
     int deny_write_cnt;                 /**< 0: writes ok, >0: deny writes. */
-    struct inode_disk data;             /**< Inode content. */
+    bool extents;                       /**< Extent format, or, if
+                                           inline, the one to take? */
+    bool inline_data;                   /**< Data in the inode? */
+    bool metadata;                      /**< Journal writes to data? */
+    struct rwlock dir_lock;             /**< Protects a directory's
+                                           entries as a whole. */
   };
 
-/** Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/** Bytes of a file that a single journal operation allocates
+   sectors for, at most, so that the index or extent blocks it
+   changes fit in JOURNAL_OP_CNT sectors, even if every sector
+   takes an extent of its own.  Metadata files journal their new
+   data sectors too, so they allocate fewer at a time. */
+#define EXTEND_CHUNK (64 * 1024)
+#define METADATA_CHUNK (8 * BLOCK_SECTOR_SIZE)
+
+/** Statistics.  Each call that reads metadata counts its own
+   reads and adds them to these totals with add_stats(). */
+static unsigned long long meta_reads;   /**< Inode, index, extent reads. */
+static unsigned long long read_meta_reads; /**< ...of those, for reading. */
+static unsigned long long read_bytes;   /**< Bytes read by inode_read_at(). */
+static struct lock stats_lock;          /**< Protects the above. */
+static unsigned long long open_calls;   /**< Calls to inode_open(). */
+static size_t max_open;                 /**< Most inodes open at once. */
+
+/** Adds META sectors of metadata read, READ_META of them for
+   reading READ bytes of data, to the statistics. */
+static void
+add_stats (unsigned meta, unsigned read_meta, off_t read)
+{
+  lock_acquire (&stats_lock);
+  meta_reads += meta;
+  read_meta_reads += read_meta;
+  read_bytes += read;
+  lock_release (&stats_lock);
+}
+
+/** Returns pointer IDX in index block or inode SECTOR. */
+static block_sector_t
+get_pointer (block_sector_t sector, size_t idx)
+{
+  struct cache_block *b = cache_lock (sector);
+  block_sector_t pointer = ((block_sector_t *) cache_read (b))[idx];
+  cache_unlock (b);
+  return pointer;
+}
+
+/** Returns the number of levels of index blocks below pointer IDX
+   in an inode. */
+static int
+pointer_level (size_t idx)
+{
+  if (idx < DIRECT_CNT)
+    return 0;
+  else if (idx < DIRECT_CNT + INDIRECT_CNT)
+    return 1;
+  else
+    return 2;
+}
+
+/** Stores in OFFSETS[] the pointer to follow at each level of an
+   inode's index, starting in the inode itself, to reach data
+   sector SECTOR_IDX of the file.  Returns the number of levels. */
+static size_t
+calculate_indices (off_t sector_idx, size_t offsets[3])
+{
+  if (sector_idx < DIRECT_CNT)
+    {
+      offsets[0] = sector_idx;
+      return 1;
+    }
+  sector_idx -= DIRECT_CNT;
+
+  if (sector_idx < PTRS_PER_SECTOR * INDIRECT_CNT)
+    {
+      offsets[0] = DIRECT_CNT + sector_idx / PTRS_PER_SECTOR;
+      offsets[1] = sector_idx % PTRS_PER_SECTOR;
+      return 2;
+    }
+  sector_idx -= PTRS_PER_SECTOR * INDIRECT_CNT;
+
+  offsets[0] = (DIRECT_CNT + INDIRECT_CNT
+                + sector_idx / (PTRS_PER_SECTOR * PTRS_PER_SECTOR));
+  offsets[1] = sector_idx / PTRS_PER_SECTOR % PTRS_PER_SECTOR;
+  offsets[2] = sector_idx % PTRS_PER_SECTOR;
+  return 3;
+}
+
+/** Marks locked block B dirty, journaling the change if JOURNAL
+   is true. */
+static void
+set_dirty (struct cache_block *b, bool journal)
+{
+  if (journal)
+    cache_journal (b);
+  else
+    cache_dirty (b);
+}
+
+/** Allocates a zeroed sector, stores a pointer to it as pointer
+   IDX in index block or inode PARENT, and returns it.  Returns 0
+   if the disk is full.  The new sector goes right after the one
+   that pointer IDX - 1 points to, or else after PARENT, if
+   possible.  Zeroing the new sector is journaled if JOURNAL is
+   true; the new pointer always is.
+
+   Updating the free map writes to the free map file, so this
+   must not be called with any cache block locked. */
+static block_sector_t
+allocate_sector (block_sector_t parent, size_t idx, bool journal)
+{
+  struct cache_block *b;
+  block_sector_t goal = parent + 1;
+  block_sector_t sector;
+
+  if (idx > 0 && get_pointer (parent, idx - 1) != 0)
+    goal = get_pointer (parent, idx - 1) + 1;
+  if (!free_map_allocate (1, goal, &sector))
+    return 0;
+
+  b = cache_lock (sector);
+  cache_zero (b);
+  set_dirty (b, journal);
+  cache_unlock (b);
+
+  b = cache_lock (parent);
+  ((block_sector_t *) cache_read (b))[idx] = sector;
+  cache_journal (b);
+  cache_unlock (b);
+
+  return sector;
+}
+
+/** Returns the sector that holds byte offset POS in the
+   indexed-format inode stored in INODE_SECTOR.  If no sector has
+   been allocated for POS yet, returns 0 if ALLOCATE is false;
+   otherwise, allocates the sector and any index blocks needed to
+   reach it, returning 0 only if the disk is full, and journals
+   zeroing the data sector if JOURNAL_DATA is true.  Adds the
+   number of index sectors read to *READS.  Callers must not grow
+   the same inode at the same time. */
+static block_sector_t
+index_lookup (block_sector_t inode_sector, off_t pos, bool allocate,
+              bool journal_data, unsigned *reads)
+{
+  size_t offsets[3];
+  size_t level_cnt = calculate_indices (pos / BLOCK_SECTOR_SIZE, offsets);
+  block_sector_t sector = inode_sector;
+  size_t level;
+
+  ASSERT (pos < INODE_SPAN);
+  for (level = 0; level < level_cnt; level++)
+    {
+      block_sector_t next = get_pointer (sector, offsets[level]);
+      (*reads)++;
+      if (next == 0
+          && (!allocate
+              || (next = allocate_sector (sector, offsets[level],
+                                          (level + 1 < level_cnt
+                                           || journal_data))) == 0))
+        return 0;
+      sector = next;
+    }
+  return sector;
+}
+
+/** Copies the extent map at the start of SECTOR, an inode or an
+   extent block, into *MAP, and counts the read in *READS. */
+static void
+read_extents (block_sector_t sector, struct extent_map *map,
+              unsigned *reads)
+{
+  struct cache_block *b = cache_lock (sector);
+  memcpy (map, cache_read (b), sizeof *map);
+  cache_unlock (b);
+  (*reads)++;
+}
+
+/** Returns the disk sector that holds sector SECTOR_IDX of the
+   extent-format inode stored in INODE_SECTOR, or 0 if none has
+   been allocated.  Adds the number of extent maps read to
+   *READS. */
+static block_sector_t
+extent_lookup (block_sector_t inode_sector, uint32_t sector_idx,
+               unsigned *reads)
+{
+  block_sector_t sector = inode_sector;
+
+  do
+    {
+      struct extent_map map;
+      size_t lo, hi;
+
+      read_extents (sector, &map, reads);
+
+      /* Find the first extent that starts after SECTOR_IDX. */
+      lo = 0;
+      hi = map.extent_cnt;
+      while (lo < hi)
+        {
+          size_t mid = (lo + hi) / 2;
+          if (map.extents[mid].file_sector <= sector_idx)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      /* SECTOR_IDX is in the extent before it, if anywhere in
+         this map. */
+      if (lo > 0)
+        {
+          const struct extent *e = &map.extents[lo - 1];
+          if (sector_idx < e->file_sector + e->cnt)
+            return e->start + (sector_idx - e->file_sector);
+        }
+      if (lo < map.extent_cnt)
+        return 0;
+      sector = map.next;
+    }
+  while (sector != 0);
+  return 0;
+}
+
+/** Adds the CNT sectors from START to the extent-format inode
+   stored in INODE_SECTOR, as its sectors from FILE_SECTOR on,
+   which must be a hole.  Returns false if an extent block was
+   needed and the disk is full.  Adds the number of extent maps
+   read to *READS. */
+static bool
+extent_insert (block_sector_t inode_sector, uint32_t file_sector,
+               block_sector_t start, uint32_t cnt, unsigned *reads)
+{
+  for (;;)
+    {
+      block_sector_t sector = inode_sector;
+      struct extent_map copy;
+      struct cache_block *b;
+      struct extent_map *map;
+      block_sector_t new_block;
+      size_t i, keep;
+
+      /* The new extent belongs in the last map whose extents do
+         not all start after it. */
+      read_extents (sector, &copy, reads);
+      while (copy.next != 0)
+        {
+          struct extent_map next;
+
+          read_extents (copy.next, &next, reads);
+          if (next.extent_cnt > 0 && next.extents[0].file_sector > file_sector)
+            break;
+          sector = copy.next;
+          copy = next;
+        }
+
+      b = cache_lock (sector);
+      map = cache_read (b);
+      for (i = 0; i < map->extent_cnt; i++)
+        if (map->extents[i].file_sector > file_sector)
+          break;
+
+      if (i > 0)
+        {
+          struct extent *prev = &map->extents[i - 1];
+          if (prev->file_sector + prev->cnt == file_sector
+              && prev->start + prev->cnt == start)
+            {
+              /* Extend the extent before. */
+              prev->cnt += cnt;
+              cache_journal (b);
+              cache_unlock (b);
+              return true;
+            }
+        }
+      if (i < map->extent_cnt)
+        {
+          struct extent *next = &map->extents[i];
+          if (file_sector + cnt == next->file_sector
+              && start + cnt == next->start)
+            {
+              /* Extend the extent after backward. */
+              next->file_sector = file_sector;
+              next->start = start;
+              next->cnt += cnt;
+              cache_journal (b);
+              cache_unlock (b);
+              return true;
+            }
+        }
+      if (map->extent_cnt < EXTENT_CNT)
+        {
+          struct extent *e = &map->extents[i];
+          memmove (e + 1, e, (map->extent_cnt - i) * sizeof *e);
+          e->file_sector = file_sector;
+          e->start = start;
+          e->cnt = cnt;
+          map->extent_cnt++;
+          cache_journal (b);
+          cache_unlock (b);
+          return true;
+        }
+      memcpy (&copy, map, sizeof copy);
+      cache_unlock (b);
+
+      /* This map is full.  Chain a new extent block to it and move
+         the upper half of the extents there, or none of them if
+         the new extent goes at the end, so that a file written
+         sequentially fills its maps. */
+      if (!free_map_allocate (1, sector, &new_block))
+        return false;
+      keep = i < EXTENT_CNT ? EXTENT_CNT / 2 : EXTENT_CNT;
+      b = cache_lock (new_block);
+      map = cache_zero (b);
+      map->extent_cnt = EXTENT_CNT - keep;
+      memcpy (map->extents, copy.extents + keep,
+              map->extent_cnt * sizeof *map->extents);
+      map->next = copy.next;
+      cache_journal (b);
+      cache_unlock (b);
+
+      b = cache_lock (sector);
+      map = cache_read (b);
+      map->extent_cnt = keep;
+      map->next = new_block;
+      cache_journal (b);
+      cache_unlock (b);
+    }
+}
+
+/** Allocates sectors for the holes among sectors FIRST up to LAST
+   of the extent-format inode stored in INODE_SECTOR.  Allocates
+   as few runs of sectors as the free map allows, each right
+   after the data before it if possible, and journals zeroing them
+   if JOURNAL_DATA is true.  Returns false if the disk is full.
+   Adds the number of extent maps read to *READS. */
+static bool
+extent_allocate (block_sector_t inode_sector, uint32_t first,
+                 uint32_t last, bool journal_data, unsigned *reads)
+{
+  while (first < last)
+    {
+      block_sector_t sector = inode_sector;
+      block_sector_t goal = inode_sector + 1;
+      uint32_t hole_end = last;
+      uint32_t want, i;
+      block_sector_t start;
+
+      /* Find the first hole from FIRST on, and aim to put its
+         sectors right after the extent before it. */
+      do
+        {
+          struct extent_map map;
+
+          read_extents (sector, &map, reads);
+          for (i = 0; i < map.extent_cnt; i++)
+            {
+              const struct extent *e = &map.extents[i];
+              if (e->file_sector > first)
+                {
+                  if (e->file_sector < hole_end)
+                    hole_end = e->file_sector;
+                  break;
+                }
+              if (first < e->file_sector + e->cnt)
+                first = e->file_sector + e->cnt;
+              goal = e->start + e->cnt;
+            }
+          sector = i < map.extent_cnt ? 0 : map.next;
+        }
+      while (sector != 0);
+      if (first >= last)
+        return true;
+
+      /* Allocate the longest run we can get, up to the size of
+         the hole, and zero it. */
+      for (want = hole_end - first; ; want /= 2)
+        if (want == 0)
+          return false;
+        else if (free_map_allocate (want, goal, &start))
+          break;
+      for (i = 0; i < want; i++)
+        {
+          struct cache_block *b = cache_lock (start + i);
+          cache_zero (b);
+          set_dirty (b, journal_data);
+          cache_unlock (b);
+        }
+
+      if (!extent_insert (inode_sector, first, start, want, reads))
+        {
+          free_map_release (start, want);
+          return false;
+        }
+      first += want;
+    }
+  return true;
+}
+
+/** Returns the disk sector that holds byte offset POS in INODE,
+   or 0 if none has been allocated.  Adds the number of metadata
+   sectors read to *READS. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+byte_to_sector (const struct inode *inode, off_t pos, unsigned *reads) 
 {
   ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+  ASSERT (!inode->inline_data);
+  if (inode->extents)
+    return extent_lookup (inode->sector, pos / BLOCK_SECTOR_SIZE, reads);
   else
-    return -1;
+    return index_lookup (inode->sector, pos, false, false, reads);
 }
 
-/** List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/** Allocates the sectors that hold bytes START up to END in the
+   inode stored in INODE_SECTOR, which is in the extent format if
+   EXTENTS is true, where there are holes.  Zeroing the new data
+   sectors is journaled if JOURNAL_DATA is true.  Returns false
+   if the disk is full.  Adds the number of metadata sectors read
+   to *READS. */
+static bool
+allocate (block_sector_t inode_sector, bool extents, bool journal_data,
+          off_t start, off_t end, unsigned *reads)
+{
+  off_t ofs;
+
+  if (extents)
+    return extent_allocate (inode_sector, start / BLOCK_SECTOR_SIZE,
+                            DIV_ROUND_UP (end, BLOCK_SECTOR_SIZE),
+                            journal_data, reads);
+
+  for (ofs = ROUND_DOWN (start, BLOCK_SECTOR_SIZE); ofs < end;
+       ofs += BLOCK_SECTOR_SIZE)
+    if (index_lookup (inode_sector, ofs, true, journal_data, reads) == 0)
+      return false;
+  return true;
+}
+
+/** Frees SECTOR, which has LEVEL levels of index blocks below it,
+   and every sector it points to. */
+static void
+deallocate (block_sector_t sector, int level)
+{
+  if (level > 0)
+    {
+      off_t i;
+
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        {
+          block_sector_t child = get_pointer (sector, i);
+          if (child != 0)
+            deallocate (child, level - 1);
+        }
+    }
+  free_map_release (sector, 1);
+}
+
+/** Frees every data, index, and extent block sector owned by the
+   inode stored in INODE_SECTOR, which is in the extent format if
+   EXTENTS is true, but not INODE_SECTOR itself. */
+static void
+deallocate_data (block_sector_t inode_sector, bool extents)
+{
+  size_t i;
+
+  if (extents)
+    {
+      block_sector_t sector = inode_sector;
+      unsigned reads = 0;
+
+      do
+        {
+          struct extent_map map;
+
+          read_extents (sector, &map, &reads);
+          for (i = 0; i < map.extent_cnt; i++)
+            free_map_release (map.extents[i].start, map.extents[i].cnt);
+          if (sector != inode_sector)
+            free_map_release (sector, 1);
+          sector = map.next;
+        }
+      while (sector != 0);
+      add_stats (reads, 0, 0);
+      return;
+    }
+
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      block_sector_t child = get_pointer (inode_sector, i);
+      if (child != 0)
+        deallocate (child, pointer_level (i));
+    }
+}
+
+/** Writes SECTOR, which has LEVEL levels of index blocks below
+   it, and every sector it points to back to disk, children
+   first. */
+static void
+sync_sector (block_sector_t sector, int level)
+{
+  if (level > 0)
+    {
+      off_t i;
+
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        {
+          block_sector_t child = get_pointer (sector, i);
+          if (child != 0)
+            sync_sector (child, level - 1);
+        }
+    }
+  cache_write_back (sector);
+}
+
+/** Open inodes, by sector number, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;    /**< Protects `open_inodes'. */
+
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
 
 /** Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  hash_init (&open_inodes, inode_hash, inode_less, NULL);
+  lock_init (&open_inodes_lock);
+  lock_init (&stats_lock);
 }
 
 /** Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The data start out inline, if they fit, or else as a
+   hole, which takes no disk space, so this takes the same time
+   whatever LENGTH is.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if LENGTH is too large. */
 bool
 inode_create (block_sector_t sector, off_t length)
 {
-  struct inode_disk *disk_inode = NULL;
-  bool success = false;
+  struct inode_disk *disk_inode;
+  struct cache_block *b;
 
   ASSERT (length >= 0);
 
   /* If this assertion fails, the inode structure is not exactly
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct extent_map) <= sizeof disk_inode->sectors);
 
-  disk_inode = calloc (1, sizeof *disk_inode);
-  if (disk_inode != NULL)
-    {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
-      free (disk_inode);
-    }
-  return success;
+  if (length > INODE_SPAN)
+    return false;
+
+  b = cache_lock (sector);
+  disk_inode = cache_zero (b);
+  disk_inode->length = length;
+  if (inode_use_inline && length <= INLINE_MAX)
+    disk_inode->magic = INLINE_MAGIC;
+  else
+    disk_inode->magic = inode_use_extents ? EXTENT_MAGIC : INODE_MAGIC;
+  cache_journal (b);
+  cache_unlock (b);
+  return true;
 }
 
-/** Reads an inode from SECTOR
-   and returns a `struct inode' that contains it.
+/** Returns a `struct inode' for the inode in SECTOR.
    Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
+  struct cache_block *b;
+  unsigned magic;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  lock_acquire (&open_inodes_lock);
+  open_calls++;
+  key.sector = sector;
+  e = hash_find (&open_inodes, &key.hash_elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, hash_elem);
+      inode->open_cnt++;
+      goto done;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    goto done;
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  Another thread opening the same inode waits for
+     `open_inodes_lock' until we are done. */
   inode->sector = sector;
+  hash_insert (&open_inodes, &inode->hash_elem);
+  if (hash_size (&open_inodes) > max_open)
+    max_open = hash_size (&open_inodes);
   inode->open_cnt = 1;
-  inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  rwlock_init (&inode->rwlock);
+  inode->deny_write_cnt = 0;
+  inode->metadata = false;
+  rwlock_init (&inode->dir_lock);
+  b = cache_lock (sector);
+  magic = ((struct inode_disk *) cache_read (b))->magic;
+  cache_unlock (b);
+  inode->inline_data = magic == INLINE_MAGIC;
+  inode->extents = (magic == EXTENT_MAGIC
+                    || (inode->inline_data && inode_use_extents));
+
+ done:
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +742,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -163,167 +763,507 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  /* Remove from inode table if this was the last opener.  Nobody
+     else can find INODE after that. */
+  lock_acquire (&open_inodes_lock);
+  last = --inode->open_cnt == 0;
+  if (last)
+    hash_delete (&open_inodes, &inode->hash_elem);
+  lock_release (&open_inodes_lock);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          journal_begin ();
+          if (!inode->inline_data)
+            deallocate_data (inode->sector, inode->extents);
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          journal_end ();
         }
 
       free (inode); 
     }
 }
 
+/** Marks INODE as holding file system metadata, such as a
+   directory, so that changes to its data are journaled. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  rwlock_acquire_write (&inode->rwlock);
+  inode->metadata = true;
+  rwlock_release_write (&inode->rwlock);
+}
+
+/** Returns the lock that serializes changes to directory INODE's
+   entries against other changes and lookups. */
+struct rwlock *
+inode_dir_lock (struct inode *inode)
+{
+  return &inode->dir_lock;
+}
+
 /** Marks INODE to be deleted when it is closed by the last caller who
    has it open. */
 void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  lock_acquire (&open_inodes_lock);
   inode->removed = true;
+  lock_release (&open_inodes_lock);
 }
 
-/** Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
-   Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
-off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+/** Reads SIZE bytes from INODE into BUFFER, starting at position
+   OFFSET, for inode_read_at(), which holds INODE's `rwlock'. */
+static off_t
+read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  off_t length = inode_length (inode);
+  unsigned reads = 0;
+
+  if (inode->inline_data)
+    {
+      if (offset < length)
+        {
+          struct cache_block *b = cache_lock (inode->sector);
+          struct inode_disk *disk_inode = cache_read (b);
+
+          bytes_read = size < length - offset ? size : length - offset;
+          memcpy (buffer, (uint8_t *) disk_inode->sectors + offset,
+                  bytes_read);
+          cache_unlock (b);
+        }
+      add_stats (0, 0, bytes_read);
+      return bytes_read;
+    }
 
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector to read. */
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
       /* Number of bytes to actually copy out of this sector. */
       int chunk_size = size < min_left ? size : min_left;
+      block_sector_t sector_idx;
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      /* Disk sector to read.  A sector never allocated reads as
+         zeros. */
+      sector_idx = byte_to_sector (inode, offset, &reads);
+      if (sector_idx != 0)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          struct cache_block *b = cache_lock (sector_idx);
+          memcpy (buffer + bytes_read,
+                  (uint8_t *) cache_read (b) + sector_ofs, chunk_size);
+          cache_unlock (b);
         }
+      else
+        memset (buffer + bytes_read, 0, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
+  add_stats (reads, reads, bytes_read);
   return bytes_read;
 }
 
-/** Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
-   Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+/** Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
+   Returns the number of bytes actually read, which may be less
+   than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-                off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
+{
+  off_t bytes_read;
+
+  rwlock_acquire_read (&inode->rwlock);
+  bytes_read = read_at (inode, buffer, size, offset);
+  rwlock_release_read (&inode->rwlock);
+  return bytes_read;
+}
+
+/** Starts reading the sectors that hold SIZE bytes of INODE,
+   starting at position OFFSET, into the buffer cache in the
+   background.  Data past the end of INODE are ignored. */
+void
+inode_read_ahead (struct inode *inode, off_t size, off_t offset)
+{
+  off_t end = offset + size;
+  unsigned reads = 0;
+
+  rwlock_acquire_read (&inode->rwlock);
+  if (!inode->inline_data)
+    {
+      if (end > inode_length (inode))
+        end = inode_length (inode);
+      for (offset = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE); offset < end;
+           offset += BLOCK_SECTOR_SIZE)
+        {
+          block_sector_t sector = byte_to_sector (inode, offset, &reads);
+          if (sector != 0)
+            cache_read_ahead (sector);
+        }
+    }
+  rwlock_release_read (&inode->rwlock);
+  add_stats (reads, reads, 0);
+}
+
+/** Allocates the sectors that hold bytes START up to END of
+   INODE where there are holes, EXTEND_CHUNK or METADATA_CHUNK
+   bytes per journal operation.  Returns false if the disk fills
+   up.  The caller must hold INODE's `rwlock' for writing. */
+static bool
+reserve (struct inode *inode, off_t start, off_t end)
+{
+  off_t chunk = inode->metadata ? METADATA_CHUNK : EXTEND_CHUNK;
+  unsigned reads = 0;
+  bool ok = true;
+  off_t ofs;
+
+  for (ofs = start; ok && ofs < end; ofs += chunk)
+    {
+      off_t chunk_end = end - ofs > chunk ? ofs + chunk : end;
+
+      journal_begin ();
+      ok = allocate (inode->sector, inode->extents, inode->metadata,
+                     ofs, chunk_end, &reads);
+      journal_end ();
+    }
+  add_stats (reads, 0, 0);
+  return ok;
+}
+
+/** Moves the data of inline INODE to a sector of their own, and
+   converts INODE to the format of its `extents' member.  Returns
+   false if memory or disk space runs out.  The caller must hold
+   INODE's `rwlock' for writing. */
+static bool
+move_inline (struct inode *inode)
+{
+  struct cache_block *b;
+  struct inode_disk *disk_inode;
+  block_sector_t sector = 0;
+  uint8_t *data;
+  bool success = false;
+
+  data = malloc (INLINE_MAX);
+  if (data == NULL)
+    return false;
+
+  journal_begin ();
+  if (inode_length (inode) == 0
+      || free_map_allocate (1, inode->sector + 1, &sector))
+    {
+      b = cache_lock (inode->sector);
+      disk_inode = cache_read (b);
+      memcpy (data, disk_inode->sectors, INLINE_MAX);
+      cache_unlock (b);
+
+      if (sector != 0)
+        {
+          b = cache_lock (sector);
+          memcpy (cache_zero (b), data, INLINE_MAX);
+          set_dirty (b, inode->metadata);
+          cache_unlock (b);
+        }
+
+      b = cache_lock (inode->sector);
+      disk_inode = cache_read (b);
+      memset (disk_inode->sectors, 0, sizeof disk_inode->sectors);
+      if (inode->extents)
+        {
+          struct extent_map *map = (struct extent_map *) disk_inode->sectors;
+          if (sector != 0)
+            {
+              map->extents[0].start = sector;
+              map->extents[0].cnt = 1;
+              map->extent_cnt = 1;
+            }
+          disk_inode->magic = EXTENT_MAGIC;
+        }
+      else
+        {
+          disk_inode->sectors[0] = sector;
+          disk_inode->magic = INODE_MAGIC;
+        }
+      cache_journal (b);
+      cache_unlock (b);
+
+      inode->inline_data = false;
+      success = true;
+    }
+  journal_end ();
+
+  free (data);
+  return success;
+}
+
+/** Writes SIZE bytes from BUFFER into inline INODE, starting at
+   OFFSET, where OFFSET + SIZE is at most INLINE_MAX.  The bytes
+   past end of file are always zeros, so any gap before OFFSET
+   needs no filling. */
+static off_t
+write_inline (struct inode *inode, const uint8_t *buffer, off_t size,
+              off_t offset)
+{
+  struct cache_block *b;
+  struct inode_disk *disk_inode;
+
+  journal_begin ();
+  b = cache_lock (inode->sector);
+  disk_inode = cache_read (b);
+  memcpy ((uint8_t *) disk_inode->sectors + offset, buffer, size);
+  if (size > 0 && offset + size > disk_inode->length)
+    disk_inode->length = offset + size;
+  cache_journal (b);
+  cache_unlock (b);
+  journal_end ();
+
+  return size;
+}
+
+/** Allocates sectors for the holes in the first LENGTH bytes of
+   INODE without changing its length, so that writing there
+   cannot run out of disk space.  Returns false if the disk is
+   full or LENGTH is too large. */
+bool
+inode_reserve (struct inode *inode, off_t length)
+{
+  bool success;
+
+  if (length > INODE_SPAN)
+    return false;
+
+  rwlock_acquire_write (&inode->rwlock);
+  if (inode->inline_data && length <= INLINE_MAX)
+    success = true;
+  else
+    success = ((!inode->inline_data || move_inline (inode))
+               && reserve (inode, 0, length));
+  rwlock_release_write (&inode->rwlock);
+  return success;
+}
+
+/** Zeros the bytes from START up to END in INODE's allocated
+   sectors, adding the number of metadata sectors read to
+   *READS. */
+static void
+zero_range (struct inode *inode, off_t start, off_t end, unsigned *reads)
+{
+  while (start < end)
+    {
+      int sector_ofs = start % BLOCK_SECTOR_SIZE;
+      off_t chunk_size = end - start;
+      block_sector_t sector_idx = byte_to_sector (inode, start, reads);
+
+      if (chunk_size > BLOCK_SECTOR_SIZE - sector_ofs)
+        chunk_size = BLOCK_SECTOR_SIZE - sector_ofs;
+      if (sector_idx != 0)
+        {
+          struct cache_block *b = cache_lock (sector_idx);
+          memset ((uint8_t *) cache_read (b) + sector_ofs, 0, chunk_size);
+          set_dirty (b, inode->metadata);
+          cache_unlock (b);
+        }
+      start += chunk_size;
+    }
+}
+
+/** Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   for inode_write_at(), which holds INODE's `rwlock' for
+   writing. */
+static off_t
+write_at (struct inode *inode, const void *buffer_, off_t size,
+          off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  off_t length, end;
+  unsigned reads = 0;
 
-  if (inode->deny_write_cnt)
+  /* No file extends past INODE_SPAN, so there is nothing to write
+     or zero up to OFFSET. */
+  if (offset >= INODE_SPAN)
     return 0;
 
+  /* Write inline data in place, or move them out of the inode if
+     they grow too large. */
+  end = offset < INODE_SPAN - size ? offset + size : INODE_SPAN;
+  if (inode->inline_data)
+    {
+      if (end <= INLINE_MAX)
+        return write_inline (inode, buffer, size, offset);
+      if (!move_inline (inode))
+        return 0;
+    }
+
+  /* Zero the gap, if any, between end of file and OFFSET in the
+     sectors already allocated.  They may hold data written just
+     before a crash that kept the file from growing over it. */
+  length = inode_length (inode);
+  if (offset > length)
+    zero_range (inode, length, offset, &reads);
+
+  /* Allocate sectors for the data.  If the disk fills up, we
+     still write as much as was allocated. */
+  reserve (inode, offset, end);
+
+  journal_begin ();
+
   while (size > 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector to write. */
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Bytes left before the inode's maximum size, bytes left in
+         sector, lesser of the two. */
+      off_t inode_left = INODE_SPAN - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
       /* Number of bytes to actually write into this sector. */
       int chunk_size = size < min_left ? size : min_left;
+      block_sector_t sector_idx;
+      struct cache_block *b;
+      uint8_t *data;
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
+      /* Sector to write. */
+      sector_idx = byte_to_sector (inode, offset, &reads);
+      if (sector_idx == 0)
+        break;
 
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* If the sector contains data before or after the chunk
+         we're writing, then we need to read in the sector
+         first.  Otherwise we start with a sector of all zeros. */
+      b = cache_lock (sector_idx);
+      if (sector_ofs > 0 || chunk_size < sector_left) 
+        data = cache_read (b);
+      else
+        data = cache_zero (b);
+      memcpy (data + sector_ofs, buffer + bytes_written, chunk_size);
+      set_dirty (b, inode->metadata);
+      cache_unlock (b);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
+  /* Extend the inode over the data written. */
+  if (bytes_written > 0 && offset > length)
+    {
+      struct cache_block *b = cache_lock (inode->sector);
+      ((struct inode_disk *) cache_read (b))->length = offset;
+      cache_journal (b);
+      cache_unlock (b);
+    }
+  journal_end ();
+  add_stats (reads, 0, 0);
+
+  return bytes_written;
+}
+
+/** Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+   Returns the number of bytes actually written, which may be
+   less than SIZE if the disk fills up or the inode reaches its
+   maximum size.  A write past end of file extends the inode,
+   leaving a hole that reads as zeros in any gap before OFFSET. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+                off_t offset) 
+{
+  off_t bytes_written = 0;
+
+  cache_throttle ();
+
+  rwlock_acquire_write (&inode->rwlock);
+  if (!inode->deny_write_cnt)
+    bytes_written = write_at (inode, buffer, size, offset);
+  rwlock_release_write (&inode->rwlock);
   return bytes_written;
 }
 
+/** Writes the dirty data sectors of INODE, which is not inline,
+   and its index or extent blocks, from the buffer cache to disk. */
+static void
+sync_data (struct inode *inode) 
+{
+  size_t i;
+
+  if (inode->extents)
+    {
+      block_sector_t sector = inode->sector;
+      unsigned reads = 0;
+
+      do
+        {
+          struct extent_map map;
+          size_t j;
+
+          read_extents (sector, &map, &reads);
+          for (i = 0; i < map.extent_cnt; i++)
+            for (j = 0; j < map.extents[i].cnt; j++)
+              cache_write_back (map.extents[i].start + j);
+          if (sector != inode->sector)
+            cache_write_back (sector);
+          sector = map.next;
+        }
+      while (sector != 0);
+      add_stats (reads, 0, 0);
+    }
+  else
+    for (i = 0; i < SECTOR_CNT; i++)
+      {
+        block_sector_t child = get_pointer (inode->sector, i);
+        if (child != 0)
+          sync_sector (child, pointer_level (i));
+      }
+}
+
+/** Writes INODE's dirty data, and its inode sector, from the
+   buffer cache to disk. */
+void
+inode_sync (struct inode *inode) 
+{
+  rwlock_acquire_read (&inode->rwlock);
+  if (!inode->inline_data)
+    sync_data (inode);
+  cache_write_back (inode->sector);
+  rwlock_release_read (&inode->rwlock);
+}
+
 /** Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /** Re-enables writes to INODE.
@@ -332,14 +1272,59 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
 }
 
 /** Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  struct cache_block *b = cache_lock (inode->sector);
+  off_t length = ((struct inode_disk *) cache_read (b))->length;
+  cache_unlock (b);
+  return length;
+}
+
+/** Prints inode statistics. */
+void
+inode_print_stats (void)
+{
+  unsigned long long meta, read_meta, read, mb;
+
+  lock_acquire (&stats_lock);
+  meta = meta_reads;
+  read_meta = read_meta_reads;
+  read = read_bytes;
+  lock_release (&stats_lock);
+
+  mb = read / (1024 * 1024);
+  printf ("Inodes: %llu metadata reads, %llu for %llu bytes read",
+          meta, read_meta, read);
+  if (mb > 0)
+    printf (" (%llu per MB)", read_meta / mb);
+  printf ("\n");
+  printf ("Inodes: %llu opens, at most %zu open at once\n",
+          open_calls, max_open);
+}
+
+/** Returns the hash value for inode E in `open_inodes'. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, hash_elem)->sector);
+}
+
+/** Returns true if inode A_'s sector precedes inode B_'s. */
+static bool
+inode_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct inode *a = hash_entry (a_, struct inode, hash_elem);
+  const struct inode *b = hash_entry (b_, struct inode, hash_elem);
+
+  return a->sector < b->sector;
 }
@@ -6,6 +6,10 @@
 #include "devices/block.h"
 
 struct bitmap;
+struct rwlock;
+
+extern bool inode_use_extents;
+extern bool inode_use_inline;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
@@ -13,11 +17,17 @@ struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
+void inode_set_metadata (struct inode *);
+struct rwlock *inode_dir_lock (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+void inode_read_ahead (struct inode *, off_t size, off_t offset);
+bool inode_reserve (struct inode *, off_t length);
+void inode_sync (struct inode *);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_print_stats (void);
 
 #endif /**< filesys/inode.h */
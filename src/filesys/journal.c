@@ -0,0 +1,478 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/** Metadata journal.
+
+   Changes to file system metadata -- inodes, index and extent
+   blocks, directories, and the free map -- are grouped into
+   transactions and written to a log before they reach their own
+   sectors, so that a crash leaves the file system as it was
+   after some transaction, never partway through an operation.
+   The log is the journal_sectors() sectors from JOURNAL_SECTOR: a
+   descriptor that lists the home sector of each logged sector,
+   then one slot per logged sector for its new contents.  Its
+   size follows from that of the disk, so formatting and mounting
+   agree on it.
+
+   Each operation that changes metadata, such as creating a file
+   or extending one, runs between journal_begin() and
+   journal_end().  These nest, and only the outermost pair counts.
+   A sector that the buffer cache marks dirty with cache_journal()
+   joins the running transaction, which collects the changes of
+   many operations.  Until the transaction commits, the cache
+   never writes the sector to its home.  If the sector has to be
+   evicted, it goes to its slot in the log instead, and it is read
+   back from there.
+
+   An operation adds at most JOURNAL_OP_CNT sectors to the
+   transaction, or as many as it asks for with
+   journal_begin_cnt().  It reserves that many slots in the log
+   before it starts, and if the log lacks room, the transaction
+   commits first.  The free map, which each commit writes, has
+   slots of its own beyond the JOURNAL_CNT that operations share,
+   one for each of its sectors.  Thus an operation never finds the
+   log full, and all of its changes commit together.
+
+   journal_commit() keeps new operations from starting, waits for
+   those under way to finish, and has the free map write its
+   changes, which adds them to the transaction.  It then writes
+   all other dirty sectors, including file data, to disk, so that
+   no committed inode can point to a sector that still holds some
+   other file's old data.  It writes each sector in the
+   transaction to its slot and writes the descriptor, whose first
+   sector, written last, commits them all at once.  Finally it
+   writes the sectors to their homes and clears the descriptor.
+   A transaction commits at the end of the operation that brings
+   it to GROUP_CNT sectors, once it is cache_dirty_age old (the
+   buffer cache's flusher sees to that), when a file is synced,
+   and at shutdown.
+
+   At startup, journal_init() copies any sectors that the
+   descriptor lists to their homes, finishing a commit that a
+   crash interrupted.  Recovery thus takes at most
+   journal_sectors() reads and writes.
+
+   Ordinary file data are not journaled.  After a crash, every
+   file's length and sectors are consistent, but data written
+   since the last commit may be missing, leaving zeros or the
+   file's earlier data in its place. */
+
+/** Identifies a descriptor. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/** Sectors in the running transaction that make it commit at the
+   end of an operation. */
+#define GROUP_CNT (JOURNAL_CNT / 4)
+
+/** Home sectors that the first sector of the descriptor lists,
+   and that each of the rest lists. */
+#define HEAD_CNT ((BLOCK_SECTOR_SIZE - 8) / sizeof (block_sector_t))
+#define MORE_CNT (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
+/** First sector of the on-disk descriptor.  The homes of slots
+   past the first HEAD_CNT follow in the sectors after it.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct descriptor
+  {
+    uint32_t magic;                     /**< JOURNAL_MAGIC. */
+    uint32_t cnt;                       /**< Sectors logged, or 0. */
+    block_sector_t sectors[HEAD_CNT];   /**< Home of each slot. */
+  };
+
+/** The running transaction.  No sectors are added while a commit
+   is under way. */
+static block_sector_t *txn_sectors;     /**< Home sectors. */
+static bool *txn_logged;                /**< Written to its slot? */
+static size_t txn_cnt;                  /**< Number of sectors. */
+static struct lock log_lock;            /**< Protects the above. */
+
+/** Operations and commits. */
+static int handle_cnt;                  /**< Operations under way. */
+static size_t reserved_cnt;             /**< Log slots they reserved. */
+static bool committing;                 /**< Commit under way? */
+static bool txn_open;                   /**< Operations since commit? */
+static int64_t txn_start;               /**< When the first began. */
+static struct lock journal_lock;        /**< Protects the above. */
+static struct condition idle;           /**< `handle_cnt' reached 0. */
+static struct condition committed;      /**< `committing' became false. */
+static bool initialized;                /**< journal_init() called? */
+
+/** Size of the log. */
+static size_t free_map_cnt;             /**< Slots for the free map. */
+static size_t slot_cnt;                 /**< All slots. */
+static size_t descriptor_cnt;           /**< Sectors in the descriptor. */
+
+/** Statistics. */
+static unsigned long long op_cnt;       /**< Operations. */
+static unsigned long long commit_cnt;   /**< Commits that logged sectors. */
+static unsigned long long logged_cnt;   /**< Sectors they logged. */
+
+/** Returns the number of log slots that the free map of the file
+   system device needs. */
+static size_t
+free_map_slots (void)
+{
+  return DIV_ROUND_UP (block_size (fs_device), BLOCK_SECTOR_SIZE * 8);
+}
+
+/** Returns the number of sectors in a descriptor that lists
+   SLOTS home sectors. */
+static size_t
+descriptor_sectors (size_t slots)
+{
+  if (slots <= HEAD_CNT)
+    return 1;
+  return 1 + DIV_ROUND_UP (slots - HEAD_CNT, MORE_CNT);
+}
+
+/** Returns the number of sectors, from JOURNAL_SECTOR on, that
+   the journal of the file system device occupies. */
+size_t
+journal_sectors (void)
+{
+  size_t slots = JOURNAL_CNT + free_map_slots ();
+
+  return descriptor_sectors (slots) + slots;
+}
+
+/** Returns the sector of the descriptor that lists the home of
+   log slot IDX, which must be at least HEAD_CNT. */
+static block_sector_t
+more_sector (size_t idx)
+{
+  return JOURNAL_SECTOR + 1 + (idx - HEAD_CNT) / MORE_CNT;
+}
+
+/** Returns the sector of log slot IDX. */
+static block_sector_t
+slot_sector (size_t idx)
+{
+  return JOURNAL_SECTOR + descriptor_cnt + idx;
+}
+
+/** Returns the index of SECTOR in the running transaction, or -1
+   if it is not there.  The caller must hold `log_lock'. */
+static int
+find (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < txn_cnt; i++)
+    if (txn_sectors[i] == sector)
+      return i;
+  return -1;
+}
+
+/** Writes a descriptor that lists the first CNT sectors of the
+   running transaction.  The homes that do not fit in the first
+   sector go out before it, so that a crash never leaves a
+   descriptor that lists stale ones. */
+static void
+write_descriptor (size_t cnt)
+{
+  struct descriptor d;
+  size_t i;
+
+  for (i = HEAD_CNT; i < cnt; i += MORE_CNT)
+    {
+      block_sector_t more[MORE_CNT];
+      size_t more_cnt = cnt - i < MORE_CNT ? cnt - i : MORE_CNT;
+
+      memset (more, 0, sizeof more);
+      memcpy (more, txn_sectors + i, more_cnt * sizeof *more);
+      block_write (fs_device, more_sector (i), more);
+    }
+
+  memset (&d, 0, sizeof d);
+  d.magic = JOURNAL_MAGIC;
+  d.cnt = cnt;
+  memcpy (d.sectors, txn_sectors,
+          (cnt < HEAD_CNT ? cnt : HEAD_CNT) * sizeof *d.sectors);
+  block_write (fs_device, JOURNAL_SECTOR, &d);
+}
+
+/** Copies the sectors of a committed transaction, if the
+   descriptor lists any, from the log to their homes. */
+static void
+replay (void)
+{
+  struct descriptor d;
+  uint8_t data[BLOCK_SECTOR_SIZE];
+  size_t i;
+
+  block_read (fs_device, JOURNAL_SECTOR, &d);
+  if (d.magic != JOURNAL_MAGIC || d.cnt == 0 || d.cnt > slot_cnt)
+    return;
+
+  /* Gather the homes into the running transaction, which is
+     empty, so that they can be read in one place. */
+  memcpy (txn_sectors, d.sectors,
+          (d.cnt < HEAD_CNT ? d.cnt : HEAD_CNT) * sizeof *d.sectors);
+  for (i = HEAD_CNT; i < d.cnt; i += MORE_CNT)
+    {
+      block_sector_t more[MORE_CNT];
+      size_t more_cnt = d.cnt - i < MORE_CNT ? d.cnt - i : MORE_CNT;
+
+      block_read (fs_device, more_sector (i), more);
+      memcpy (txn_sectors + i, more, more_cnt * sizeof *more);
+    }
+
+  printf ("Replaying journal (%u sectors)...", (unsigned) d.cnt);
+  for (i = 0; i < d.cnt; i++)
+    {
+      block_read (fs_device, slot_sector (i), data);
+      block_write (fs_device, txn_sectors[i], data);
+    }
+  write_descriptor (0);
+  printf ("done.\n");
+}
+
+/** Initializes the journal.  If FORMAT is true, starts with an
+   empty log; otherwise, recovers from the log. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof (struct descriptor) == BLOCK_SECTOR_SIZE);
+
+  lock_init (&log_lock);
+  lock_init (&journal_lock);
+  cond_init (&idle);
+  cond_init (&committed);
+  txn_cnt = 0;
+  handle_cnt = 0;
+  committing = false;
+  txn_open = false;
+  reserved_cnt = 0;
+
+  free_map_cnt = free_map_slots ();
+  slot_cnt = JOURNAL_CNT + free_map_cnt;
+  descriptor_cnt = descriptor_sectors (slot_cnt);
+  txn_sectors = malloc (slot_cnt * sizeof *txn_sectors);
+  txn_logged = malloc (slot_cnt * sizeof *txn_logged);
+  if (txn_sectors == NULL || txn_logged == NULL)
+    PANIC ("journal allocation failed--file system device is too large");
+
+  if (format)
+    write_descriptor (0);
+  else
+    replay ();
+  initialized = true;
+}
+
+/** Begins an operation that changes metadata and adds at most
+   JOURNAL_OP_CNT sectors to the running transaction. */
+void
+journal_begin (void)
+{
+  journal_begin_cnt (JOURNAL_OP_CNT);
+}
+
+/** Begins an operation that changes metadata and adds at most
+   CNT sectors to the running transaction.  Waits for any commit
+   under way to finish first, and commits the transaction if the
+   log lacks CNT free slots, unless the operation is nested in
+   another, which must have reserved the slots. */
+void
+journal_begin_cnt (size_t cnt)
+{
+  struct thread *t = thread_current ();
+
+  if (t->journal_depth > 0)
+    {
+      t->journal_depth++;
+      return;
+    }
+  ASSERT (cnt <= JOURNAL_CNT);
+
+  for (;;)
+    {
+      size_t used;
+
+      lock_acquire (&journal_lock);
+      while (committing)
+        cond_wait (&committed, &journal_lock);
+      lock_acquire (&log_lock);
+      used = txn_cnt;
+      lock_release (&log_lock);
+      if (free_map_cnt + used + reserved_cnt + cnt <= slot_cnt)
+        break;
+      lock_release (&journal_lock);
+      journal_commit ();
+    }
+  if (!txn_open)
+    {
+      txn_open = true;
+      txn_start = timer_ticks ();
+    }
+  reserved_cnt += cnt;
+  handle_cnt++;
+  op_cnt++;
+  lock_release (&journal_lock);
+
+  t->journal_depth = 1;
+  t->journal_cnt = cnt;
+}
+
+/** Ends an operation begun with journal_begin().  Commits the
+   running transaction if it has grown large. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+  bool full;
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  reserved_cnt -= t->journal_cnt;
+  if (--handle_cnt == 0)
+    cond_broadcast (&idle, &journal_lock);
+  lock_release (&journal_lock);
+
+  lock_acquire (&log_lock);
+  full = txn_cnt >= GROUP_CNT;
+  lock_release (&log_lock);
+  if (full)
+    journal_commit ();
+}
+
+/** Commits the running transaction and writes its sectors to
+   their homes.  The caller must not be in an operation. */
+void
+journal_commit (void)
+{
+  struct thread *t = thread_current ();
+  size_t cnt, i;
+
+  ASSERT (t->journal_depth == 0);
+
+  /* Keep new operations out and wait for the rest to finish. */
+  lock_acquire (&journal_lock);
+  while (committing)
+    cond_wait (&committed, &journal_lock);
+  committing = true;
+  while (handle_cnt > 0)
+    cond_wait (&idle, &journal_lock);
+  txn_open = false;
+  lock_release (&journal_lock);
+
+  /* Add the free map's changes.  This is an operation of our
+     own, which must not wait for the commit. */
+  t->journal_depth++;
+  free_map_flush ();
+  t->journal_depth--;
+
+  lock_acquire (&log_lock);
+  cnt = txn_cnt;
+  lock_release (&log_lock);
+  if (cnt > 0)
+    {
+      /* Write the data first, then log each sector not already
+         in its slot, then commit. */
+      cache_flush ();
+      for (i = 0; i < cnt; i++)
+        cache_write_back (txn_sectors[i]);
+      write_descriptor (cnt);
+
+      /* Move the sectors home and empty the log. */
+      for (i = 0; i < cnt; i++)
+        cache_checkpoint (txn_sectors[i]);
+      lock_acquire (&log_lock);
+      txn_cnt = 0;
+      lock_release (&log_lock);
+      write_descriptor (0);
+
+      commit_cnt++;
+      logged_cnt += cnt;
+    }
+
+  lock_acquire (&journal_lock);
+  committing = false;
+  cond_broadcast (&committed, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/** Commits the running transaction if its first operation began
+   at least MIN_AGE timer ticks ago. */
+void
+journal_commit_old (int64_t min_age)
+{
+  bool old;
+
+  if (!initialized)
+    return;
+
+  lock_acquire (&journal_lock);
+  old = txn_open && timer_elapsed (txn_start) >= min_age;
+  lock_release (&journal_lock);
+  if (old)
+    journal_commit ();
+}
+
+/** Adds SECTOR, which the caller has changed and holds locked in
+   the buffer cache, to the running transaction.  The slots that
+   operations reserve keep the log from filling up, so a full log
+   is a bug. */
+void
+journal_add (block_sector_t sector)
+{
+  lock_acquire (&log_lock);
+  if (find (sector) < 0)
+    {
+      if (txn_cnt >= slot_cnt)
+        PANIC ("journal overflow");
+      txn_logged[txn_cnt] = false;
+      txn_sectors[txn_cnt++] = sector;
+    }
+  lock_release (&log_lock);
+}
+
+/** Returns the log slot to which SECTOR, which is in the running
+   transaction, must be written back. */
+block_sector_t
+journal_log_slot (block_sector_t sector)
+{
+  int idx;
+
+  lock_acquire (&log_lock);
+  idx = find (sector);
+  ASSERT (idx >= 0);
+  txn_logged[idx] = true;
+  lock_release (&log_lock);
+  return slot_sector (idx);
+}
+
+/** Returns the sector from which to read SECTOR: its log slot,
+   if it was written there, or else SECTOR itself. */
+block_sector_t
+journal_read_slot (block_sector_t sector)
+{
+  int idx;
+
+  lock_acquire (&log_lock);
+  idx = find (sector);
+  if (idx >= 0 && txn_logged[idx])
+    sector = slot_sector (idx);
+  lock_release (&log_lock);
+  return sector;
+}
+
+/** Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %llu operations, %llu commits, %llu sectors logged\n",
+          op_cnt, commit_cnt, logged_cnt);
+}
@@ -0,0 +1,30 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/** Sectors that the operations of a single commit log, at most.
+   The log also has a slot for each sector of the free map. */
+#define JOURNAL_CNT ((BLOCK_SECTOR_SIZE - 8) / sizeof (block_sector_t))
+
+/** Sectors that an operation begun with journal_begin() may add
+   to the running transaction, at most. */
+#define JOURNAL_OP_CNT 24
+
+size_t journal_sectors (void);
+void journal_init (bool format);
+void journal_begin (void);
+void journal_begin_cnt (size_t cnt);
+void journal_end (void);
+void journal_commit (void);
+void journal_commit_old (int64_t min_age);
+void journal_print_stats (void);
+
+void journal_add (block_sector_t);
+block_sector_t journal_log_slot (block_sector_t);
+block_sector_t journal_read_slot (block_sector_t);
+
+#endif /**< filesys/journal.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+/** A process's paging statistics, as reported by the memstat
+   system call.  The kernel samples each process's resident pages
+   periodically; `resident' and `working_set' describe the most
+   recent sample. */
+struct memstat
+  {
+    unsigned resident;          /**< Pages in memory. */
+    unsigned working_set;       /**< ...of which referenced since the
+                                   previous sample. */
+    unsigned peak_working_set;  /**< Largest working set so far. */
+    unsigned long long minor_faults; /**< Faults handled without I/O. */
+    unsigned long long major_faults; /**< Faults that read from disk. */
+    unsigned long long evictions;    /**< Pages evicted from memory. */
+    unsigned long long swap_ins;     /**< Pages read back from swap. */
+  };
+
+#endif /**< lib/memstat.h */
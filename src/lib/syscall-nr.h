@@ -28,7 +28,12 @@ enum
     SYS_MKDIR,                  /**< Create a directory. */
     SYS_READDIR,                /**< Reads a directory entry. */
     SYS_ISDIR,                  /**< Tests if a fd represents a directory. */
-    SYS_INUMBER                 /**< Returns the inode number for a fd. */
+    SYS_INUMBER,                /**< Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /**< Duplicate this process. */
+    SYS_MEMSTAT,                /**< Get paging statistics. */
+    SYS_FSYNC                   /**< Write a file's cached data to disk. */
   };
 
 #endif /**< lib/syscall-nr.h */
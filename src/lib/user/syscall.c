@@ -182,3 +182,21 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+bool
+memstat (struct memstat *ms)
+{
+  return syscall1 (SYS_MEMSTAT, ms);
+}
+
+void
+fsync (int fd)
+{
+  syscall1 (SYS_FSYNC, fd);
+}
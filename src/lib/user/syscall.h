@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <memstat.h>
 
 /** Process identifier. */
 typedef int pid_t;
@@ -45,4 +46,9 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/** Extensions. */
+pid_t fork (void);
+bool memstat (struct memstat *);
+void fsync (int fd);
+
 #endif /**< lib/user/syscall.h */
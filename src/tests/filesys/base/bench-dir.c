@@ -0,0 +1,47 @@
+/** Creates a few hundred files in the root directory, opens each
+   of them, and removes them all.  The kernel reports at shutdown
+   how many directory buckets each name lookup read, and the
+   average number of entries in the directories searched. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 300
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i;
+
+  msg ("creating %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  msg ("opening %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "file%d", i);
+      fd = open (name);
+      if (fd < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+
+  msg ("removing %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  CHECK (open ("file0") == -1, "open \"file0\" after removal");
+}
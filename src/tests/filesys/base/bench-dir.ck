@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-dir) begin
+(bench-dir) creating 300 files
+(bench-dir) opening 300 files
+(bench-dir) removing 300 files
+(bench-dir) open "file0" after removal
+(bench-dir) end
+EOF
+pass;
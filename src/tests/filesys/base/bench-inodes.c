@@ -0,0 +1,18 @@
+/** Spawns several child processes, each of which keeps many
+   distinct files open at once while it opens and closes them
+   over and over, so that the kernel's table of open inodes grows
+   large. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/bench-inodes.h"
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+
+  exec_children ("child-inodes", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
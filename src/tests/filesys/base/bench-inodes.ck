@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-inodes) begin
+(bench-inodes) exec child 1 of 4: "child-inodes 0"
+(bench-inodes) exec child 2 of 4: "child-inodes 1"
+(bench-inodes) exec child 3 of 4: "child-inodes 2"
+(bench-inodes) exec child 4 of 4: "child-inodes 3"
+(bench-inodes) wait for child 1 of 4 returned 0 (expected 0)
+(bench-inodes) wait for child 2 of 4 returned 1 (expected 1)
+(bench-inodes) wait for child 3 of 4 returned 2 (expected 2)
+(bench-inodes) wait for child 4 of 4 returned 3 (expected 3)
+(bench-inodes) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+#ifndef TESTS_FILESYS_BASE_BENCH_INODES_H
+#define TESTS_FILESYS_BASE_BENCH_INODES_H
+
+#define CHILD_CNT 4
+#define FILE_CNT 50
+#define ROUNDS 10
+
+#endif /**< tests/filesys/base/bench-inodes.h */
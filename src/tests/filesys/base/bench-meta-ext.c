@@ -0,0 +1,6 @@
+/** Writes a 1 MB file sequentially and reads it back, in the
+   extent inode format.  The kernel reports how many inode and
+   extent block sectors it read per MB of data at shutdown;
+   compare with bench-meta. */
+
+#include "tests/filesys/base/bench-meta.inc"
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF');
+(bench-meta-ext) begin
+(bench-meta-ext) create "bench"
+(bench-meta-ext) open "bench"
+(bench-meta-ext) write "bench"
+(bench-meta-ext) close "bench"
+(bench-meta-ext) open "bench" for verification
+(bench-meta-ext) verified contents of "bench"
+(bench-meta-ext) close "bench"
+(bench-meta-ext) end
+EOF
+pass;
@@ -0,0 +1,6 @@
+/** Writes a 1 MB file sequentially and reads it back, in the
+   default indexed inode format.  The kernel reports how many
+   inode and index sectors it read per MB of data at shutdown;
+   compare with bench-meta-ext. */
+
+#include "tests/filesys/base/bench-meta.inc"
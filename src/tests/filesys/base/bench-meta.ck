@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF');
+(bench-meta) begin
+(bench-meta) create "bench"
+(bench-meta) open "bench"
+(bench-meta) write "bench"
+(bench-meta) close "bench"
+(bench-meta) open "bench" for verification
+(bench-meta) verified contents of "bench"
+(bench-meta) close "bench"
+(bench-meta) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/** Opens the same few files, and a file that does not exist,
+   over and over.  The kernel reports its directory entry cache
+   hits and misses at shutdown; all but the first lookup of each
+   name should hit. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 4
+#define ROUNDS 250
+
+static const char *names[FILE_CNT] = {"alpha", "beta", "gamma", "delta"};
+
+void
+test_main (void) 
+{
+  int round, i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    CHECK (create (names[i], 0), "create \"%s\"", names[i]);
+
+  msg ("opening files %d times each", ROUNDS);
+  for (round = 0; round < ROUNDS; round++)
+    {
+      for (i = 0; i < FILE_CNT; i++)
+        {
+          int fd = open (names[i]);
+          if (fd < 2)
+            fail ("open \"%s\" failed", names[i]);
+          close (fd);
+        }
+      if (open ("missing") != -1)
+        fail ("open \"missing\" succeeded");
+    }
+  msg ("done opening files");
+}
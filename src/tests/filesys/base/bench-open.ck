@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-open) begin
+(bench-open) create "alpha"
+(bench-open) create "beta"
+(bench-open) create "gamma"
+(bench-open) create "delta"
+(bench-open) opening files 250 times each
+(bench-open) done opening files
+(bench-open) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+/** Reads a 128 kB file 4 times over with a single reader
+   process.  The kernel reports the ticks it spent, and how many
+   of them it sat idle waiting for the disk, at shutdown; compare
+   with bench-readers-4 and bench-readers-16, which do the same
+   reading with more readers. */
+
+#define READER_CNT 1
+#include "tests/filesys/base/bench-readers.inc"
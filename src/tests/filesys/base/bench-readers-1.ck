@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-readers-1) begin
+(bench-readers-1) create "data"
+(bench-readers-1) open "data"
+(bench-readers-1) write "data"
+(bench-readers-1) close "data"
+(bench-readers-1) read "data" 4 times with 1 readers
+(bench-readers-1) all readers done
+(bench-readers-1) end
+EOF
+pass;
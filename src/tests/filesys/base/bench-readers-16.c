@@ -0,0 +1,7 @@
+/** Reads a 128 kB file 4 times over with 16 reader processes at
+   once, each reading a sixteenth of it.  Compare the ticks that
+   the kernel reports at shutdown with bench-readers-1 and
+   bench-readers-4. */
+
+#define READER_CNT 16
+#include "tests/filesys/base/bench-readers.inc"
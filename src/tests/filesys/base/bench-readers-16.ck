@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-readers-16) begin
+(bench-readers-16) create "data"
+(bench-readers-16) open "data"
+(bench-readers-16) write "data"
+(bench-readers-16) close "data"
+(bench-readers-16) read "data" 4 times with 16 readers
+(bench-readers-16) all readers done
+(bench-readers-16) end
+EOF
+pass;
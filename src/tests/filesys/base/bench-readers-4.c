@@ -0,0 +1,8 @@
+/** Reads a 128 kB file 4 times over with 4 reader processes at
+   once, each reading a quarter of it.  Compare the ticks that
+   the kernel reports at shutdown with bench-readers-1: readers
+   that do not wait for one another in the file system keep the
+   CPU busy while the disk works. */
+
+#define READER_CNT 4
+#include "tests/filesys/base/bench-readers.inc"
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-readers-4) begin
+(bench-readers-4) create "data"
+(bench-readers-4) open "data"
+(bench-readers-4) write "data"
+(bench-readers-4) close "data"
+(bench-readers-4) read "data" 4 times with 4 readers
+(bench-readers-4) all readers done
+(bench-readers-4) end
+EOF
+pass;
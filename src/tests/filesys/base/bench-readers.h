@@ -0,0 +1,11 @@
+#ifndef TESTS_FILESYS_BASE_BENCH_READERS_H
+#define TESTS_FILESYS_BASE_BENCH_READERS_H
+
+/* Four times the size of the kernel's buffer cache, so that the
+   readers wait for the disk. */
+#define FILE_SIZE (128 * 1024)
+#define CHUNK_SIZE 512
+#define PASS_CNT 4
+static const char file_name[] = "data";
+
+#endif /**< tests/filesys/base/bench-readers.h */
@@ -0,0 +1,53 @@
+/** Grows two files at the same time, one sector at a time, then
+   reads each of them back sequentially.  The kernel reports the
+   number of seeks on the file system device at shutdown, which
+   stays low only if each file's data ended up together on disk
+   despite the interleaved writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (200 * 1024)
+#define CHUNK_SIZE 512
+
+static char buf[CHUNK_SIZE];
+static char data[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  static const char *names[2] = {"a", "b"};
+  int fds[2];
+  size_t ofs;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      CHECK (create (names[i], 0), "create \"%s\"", names[i]);
+      CHECK ((fds[i] = open (names[i])) > 1, "open \"%s\"", names[i]);
+    }
+
+  msg ("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    for (i = 0; i < 2; i++)
+      {
+        memset (buf, names[i][0], sizeof buf);
+        if (write (fds[i], buf, sizeof buf) != sizeof buf)
+          fail ("write %d bytes at offset %zu in \"%s\" failed",
+                CHUNK_SIZE, ofs, names[i]);
+      }
+
+  for (i = 0; i < 2; i++)
+    {
+      msg ("close \"%s\"", names[i]);
+      close (fds[i]);
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      memset (data, names[i][0], sizeof data);
+      check_file (names[i], data, sizeof data);
+    }
+}
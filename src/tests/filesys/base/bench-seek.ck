@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-seek) begin
+(bench-seek) create "a"
+(bench-seek) open "a"
+(bench-seek) create "b"
+(bench-seek) open "b"
+(bench-seek) write "a" and "b" alternately
+(bench-seek) close "a"
+(bench-seek) close "b"
+(bench-seek) open "a" for verification
+(bench-seek) verified contents of "a"
+(bench-seek) close "a"
+(bench-seek) open "b" for verification
+(bench-seek) verified contents of "b"
+(bench-seek) close "b"
+(bench-seek) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/** Creates many small files on a large (100 MB) file system and
+   checks one of them.  The kernel's disk write count at shutdown
+   shows how much of the free map each allocation rewrites. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+static char buf[100];
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i;
+
+  memset (buf, 'x', sizeof buf);
+  msg ("creating %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "small%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      fd = open (name);
+      if (fd < 2)
+        fail ("open \"%s\" failed", name);
+      if (write (fd, buf, sizeof buf) != sizeof buf)
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+  check_file ("small0", buf, sizeof buf);
+}
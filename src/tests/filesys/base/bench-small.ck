@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-small) begin
+(bench-small) creating 200 files
+(bench-small) open "small0" for verification
+(bench-small) verified contents of "small0"
+(bench-small) close "small0"
+(bench-small) end
+EOF
+pass;
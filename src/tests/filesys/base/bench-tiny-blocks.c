@@ -0,0 +1,6 @@
+/** Creates many files of a few hundred bytes each and reads them
+   back, with each file's data in a sector of its own.  The
+   kernel's disk read and write counts at shutdown show the I/O
+   this takes; compare with bench-tiny. */
+
+#include "tests/filesys/base/bench-tiny.inc"
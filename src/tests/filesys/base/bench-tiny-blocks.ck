@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bench-tiny-blocks) begin
+(bench-tiny-blocks) creating 200 files of 300 bytes
+(bench-tiny-blocks) reading them back
+(bench-tiny-blocks) end
+EOF
+pass;
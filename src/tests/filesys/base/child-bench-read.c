@@ -0,0 +1,55 @@
+/** Child process for the bench-readers tests.
+   Reads part IDX of CNT equal parts of the test file, PASS_CNT
+   times over, a sector at a time, and checks what it reads.
+   Other processes read the other parts at the same time.
+
+   The expected data come from the same random stream that the
+   parent wrote, regenerated a chunk at a time on each pass, so
+   that many children at once fit in memory. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/bench-readers.h"
+
+const char *test_name = "child-bench-read";
+
+int
+main (int argc, const char *argv[]) 
+{
+  char chunk[CHUNK_SIZE];
+  char expected[CHUNK_SIZE];
+  int child_idx, child_cnt;
+  size_t start, end, ofs;
+  int fd, pass;
+
+  quiet = true;
+
+  CHECK (argc == 3, "argc must be 3, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  child_cnt = atoi (argv[2]);
+  start = FILE_SIZE / child_cnt * child_idx;
+  end = start + FILE_SIZE / child_cnt;
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      /* Consume the random stream up to our part. */
+      random_init (0);
+      for (ofs = 0; ofs < start; ofs += CHUNK_SIZE)
+        random_bytes (expected, CHUNK_SIZE);
+
+      seek (fd, start);
+      for (ofs = start; ofs < end; ofs += CHUNK_SIZE)
+        {
+          random_bytes (expected, CHUNK_SIZE);
+          CHECK (read (fd, chunk, CHUNK_SIZE) == CHUNK_SIZE,
+                 "read \"%s\"", file_name);
+          compare_bytes (chunk, expected, CHUNK_SIZE, ofs, file_name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
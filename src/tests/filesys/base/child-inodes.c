@@ -0,0 +1,53 @@
+/** Child process for bench-inodes test.
+   Creates FILE_CNT files of its own and opens all of them, then
+   opens and closes each of them ROUNDS more times while they are
+   all still open, and finally closes and removes them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/bench-inodes.h"
+
+const char *test_name = "child-inodes";
+
+static int fds[FILE_CNT];
+
+int
+main (int argc, const char *argv[]) 
+{
+  char name[16];
+  int child_idx;
+  int round, i;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "c%d-%d", child_idx, i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fds[i] = open (name)) > 1, "open \"%s\"", name);
+    }
+
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        int fd;
+
+        snprintf (name, sizeof name, "c%d-%d", child_idx, i);
+        CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+        close (fd);
+      }
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "c%d-%d", child_idx, i);
+      close (fds[i]);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+
+  return child_idx;
+}
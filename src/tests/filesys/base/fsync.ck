@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync) begin
+(fsync) create "data"
+(fsync) open "data"
+(fsync) write "data"
+(fsync) fsync "data"
+(fsync) close "data"
+(fsync) open "data" for verification
+(fsync) verified contents of "data"
+(fsync) close "data"
+(fsync) end
+EOF
+pass;
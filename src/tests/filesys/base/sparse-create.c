@@ -0,0 +1,61 @@
+/** Creates many files whose initial sizes add up to far more
+   than the 2 MB disk holds.  Their data are holes, which take no
+   disk space until written, so every create succeeds.  Then
+   writes into the middle of one of them and checks that the
+   rest of it still reads as zeros. */
+
+#include <string.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 16
+#define FILE_SIZE (4 * 1024 * 1024)
+
+static char buf[1024];
+static char zeros[sizeof buf];
+
+void
+test_main (void) 
+{
+  static const char data[] = "sparse";
+  char name[16];
+  int fd, i;
+
+  msg ("creating %d files of %d bytes each", FILE_CNT, FILE_SIZE);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "sparse%d", i);
+      if (!create (name, FILE_SIZE))
+        fail ("create \"%s\" failed", name);
+    }
+
+  CHECK ((fd = open ("sparse0")) > 1, "open \"sparse0\"");
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"sparse0\"");
+  msg ("write \"sparse0\" at offset %d", FILE_SIZE / 2);
+  seek (fd, FILE_SIZE / 2);
+  CHECK (write (fd, data, sizeof data) == sizeof data,
+         "write \"sparse0\"");
+
+  msg ("read back \"sparse0\"");
+  seek (fd, FILE_SIZE / 2 - sizeof buf / 2);
+  if (read (fd, buf, sizeof buf) != sizeof buf)
+    fail ("read \"sparse0\" failed");
+  if (memcmp (buf, zeros, sizeof buf / 2)
+      || memcmp (buf + sizeof buf / 2, data, sizeof data)
+      || memcmp (buf + sizeof buf / 2 + sizeof data, zeros,
+                 sizeof buf / 2 - sizeof data))
+    fail ("\"sparse0\" has wrong data around offset %d", FILE_SIZE / 2);
+  for (i = 0; i < 4; i++)
+    {
+      static const int offsets[] = {0, FILE_SIZE / 4, FILE_SIZE / 4 * 3,
+                                    FILE_SIZE - sizeof buf};
+      seek (fd, offsets[i]);
+      if (read (fd, buf, sizeof buf) != sizeof buf
+          || memcmp (buf, zeros, sizeof buf))
+        fail ("\"sparse0\" is not zeros at offset %d", offsets[i]);
+    }
+  msg ("close \"sparse0\"");
+  close (fd);
+}
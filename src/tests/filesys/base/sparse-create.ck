@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sparse-create) begin
+(sparse-create) creating 16 files of 4194304 bytes each
+(sparse-create) open "sparse0"
+(sparse-create) filesize "sparse0"
+(sparse-create) write "sparse0" at offset 2097152
+(sparse-create) write "sparse0"
+(sparse-create) read back "sparse0"
+(sparse-create) close "sparse0"
+(sparse-create) end
+EOF
+pass;
@@ -0,0 +1,95 @@
+/** crash-check.c
+
+   Checks the files that crash-create or crash-grow left behind
+   when it was killed, after the kernel has recovered the file
+   system from the journal.  Run as "crash-check create" or
+   "crash-check grow".
+
+   Data written just before the kill may not have reached the
+   disk, so a file may hold null bytes where its data should be,
+   but nothing else.  A file may also be missing, if the test
+   was between removing and creating it.  Finally, checks that
+   the recovered file system takes a new file. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "crash-check";
+
+/** Checks that file NAME, if it exists, holds only bytes BYTE and
+   null bytes, or that it is empty if BYTE is 0. */
+static void
+check_fill (const char *name, char byte) 
+{
+  char block[512];
+  int length, ofs;
+  int fd;
+
+  fd = open (name);
+  if (fd < 2)
+    return;
+
+  length = filesize (fd);
+  if (byte == '\0' && length != 0)
+    fail ("\"%s\" should be empty but has %d bytes", name, length);
+  for (ofs = 0; ofs < length; ofs += sizeof block)
+    {
+      int block_size = length - ofs < (int) sizeof block
+                       ? length - ofs : (int) sizeof block;
+      int i;
+
+      if (read (fd, block, block_size) != block_size)
+        fail ("read of %d bytes at offset %d in \"%s\" failed",
+              block_size, ofs, name);
+      for (i = 0; i < block_size; i++)
+        if (block[i] != byte && block[i] != '\0')
+          fail ("\"%s\" holds byte 0x%02x at offset %d",
+                name, (unsigned char) block[i], ofs + i);
+    }
+  close (fd);
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  static char buf[4096];
+  char name[16];
+  int fd, i;
+
+  if (argc != 2)
+    fail ("usage: crash-check create|grow");
+
+  if (!strcmp (argv[1], "create"))
+    {
+      for (i = 0; i < 16; i++)
+        {
+          snprintf (name, sizeof name, "f%d", i);
+          check_fill (name, 'a' + i);
+        }
+      msg ("files \"f0\" through \"f15\" are intact");
+    }
+  else if (!strcmp (argv[1], "grow"))
+    {
+      check_fill ("log", 'x');
+      msg ("file \"log\" is intact");
+      for (i = 0; i < 200; i++)
+        {
+          snprintf (name, sizeof name, "g%d", i);
+          check_fill (name, '\0');
+        }
+      msg ("files \"g0\" through \"g199\" are intact");
+    }
+  else
+    fail ("unknown test \"%s\"", argv[1]);
+
+  memset (buf, 'n', sizeof buf);
+  CHECK (create ("new", 0), "create \"new\"");
+  CHECK ((fd = open ("new")) > 1, "open \"new\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"new\"");
+  msg ("close \"new\"");
+  close (fd);
+  check_file ("new", buf, sizeof buf);
+  return 0;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(crash-check) files "f0" through "f15" are intact
+(crash-check) create "new"
+(crash-check) open "new"
+(crash-check) write "new"
+(crash-check) close "new"
+(crash-check) open "new" for verification
+(crash-check) verified contents of "new"
+(crash-check) close "new"
+EOF
+pass;
@@ -0,0 +1,45 @@
+/** Creates, writes, and removes files over and over until the
+   test is killed, as a crash would stop it: partway through some
+   operation.  File "fN", for N from 0 to 15, always holds bytes
+   'a' + N, and is sometimes created with its full size and
+   sometimes grown by writing.
+
+   The persistence check then verifies that the file system came
+   back consistent. */
+
+#include <string.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 16
+
+static char buf[8192];
+
+void
+test_main (void) 
+{
+  int i;
+
+  msg ("creating and removing files until killed...");
+  for (i = 0; ; i++) 
+    {
+      int n = i % FILE_CNT;
+      size_t size = (i * 1237) % sizeof buf;
+      char file_name[16];
+      int fd;
+
+      snprintf (file_name, sizeof file_name, "f%d", n);
+      remove (file_name);
+      if (!create (file_name, i % 3 == 0 ? size : 0))
+        continue;
+      memset (buf, 'a' + n, size);
+      fd = open (file_name);
+      if (fd > 1)
+        {
+          write (fd, buf, size);
+          close (fd);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/** Grows a file and the root directory until the test is killed,
+   as a crash would stop it: partway through some operation.
+   File "log" is appended to in pieces of various sizes and
+   always holds 'x' bytes.  The root directory gains and loses
+   empty files "gN", which makes it grow.
+
+   The persistence check then verifies that the file system came
+   back consistent. */
+
+#include <string.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/** Most "gN" files at once. */
+#define DIR_CNT 200
+
+/** "log" is started over when it grows past this size. */
+#define LOG_MAX (256 * 1024)
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  int log_size = 0;
+  int fd;
+  int i;
+
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK ((fd = open ("log")) > 1, "open \"log\"");
+  memset (buf, 'x', sizeof buf);
+
+  msg ("growing \"log\" and the root directory until killed...");
+  for (i = 0; ; i++) 
+    {
+      char file_name[16];
+      int size = (i * 739) % sizeof buf + 1;
+
+      if (log_size + size > LOG_MAX)
+        {
+          close (fd);
+          remove ("log");
+          create ("log", 0);
+          fd = open ("log");
+          log_size = 0;
+        }
+      if (write (fd, buf, size) == size)
+        log_size += size;
+
+      snprintf (file_name, sizeof file_name, "g%d", i % DIR_CNT);
+      if (i / DIR_CNT % 2 == 0)
+        create (file_name, 0);
+      else
+        remove (file_name);
+    }
+}
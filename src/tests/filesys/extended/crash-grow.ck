@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_killed ("growing \"log\" and the root directory until killed...");
+pass;
@@ -315,6 +315,28 @@ EOF
     fail "Extracted file system contents are not correct.\n" if $errors;
 }
 
+# check_killed ($LOOP_MSG)
+#
+# Checks the output of a run that should have reached the point
+# where the test prints $LOOP_MSG and then kept going until it
+# was killed for running too long.
+sub check_killed {
+    my ($loop_msg) = @_;
+
+    my (@output) = read_text_file ("$test.output");
+    fail "Run produced no output at all\n" if @output == 0;
+    check_for_panic ("run", @output);
+    check_for_keyword ("run", "FAIL", @output);
+    check_for_triple_fault ("run", @output);
+
+    my ($test_base_name) = $test;
+    $test_base_name =~ s%.*/%%;
+    fail "Run never printed \"($test_base_name) $loop_msg\"\n"
+      if !grep ($_ eq "($test_base_name) $loop_msg", @output);
+    fail "Run wasn't killed: no \"TIMEOUT\" message\n"
+      if !grep (/^TIMEOUT after/, @output);
+}
+
 # open_file ([$FILE, $OFFSET, $LENGTH])
 # open_file ([$CONTENTS])
 #
@@ -0,0 +1,87 @@
+/** Compares the throughput of a lock and of a readers-writer
+   lock held for reading, with 1 to 16 threads reading at once.
+   Each read holds the lock for a timer tick, as if waiting for a
+   device, so a lock lets only one reader make progress at a time
+   while a readers-writer lock lets them all.  Prints the reads
+   completed per second for each. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READ_CNT 10                     /**< Reads per thread. */
+
+static thread_func lock_thread, rwlock_thread;
+static struct lock lock;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+/** Runs THREAD_CNT threads of FUNC, each making READ_CNT reads,
+   and returns the reads completed per second. */
+static int
+run (thread_func *func, int thread_cnt) 
+{
+  int64_t start = timer_ticks ();
+  int64_t elapsed;
+  int i;
+
+  for (i = 0; i < thread_cnt; i++)
+    thread_create ("reader", PRI_DEFAULT, func, NULL);
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  elapsed = timer_elapsed (start);
+  return thread_cnt * READ_CNT * TIMER_FREQ / (elapsed > 0 ? elapsed : 1);
+}
+
+void
+test_rwlock_bench (void) 
+{
+  int thread_cnt;
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  for (thread_cnt = 1; thread_cnt <= 16; thread_cnt *= 2)
+    {
+      int lock_rate = run (lock_thread, thread_cnt);
+      int rwlock_rate = run (rwlock_thread, thread_cnt);
+
+      msg ("%2d readers: lock %4d reads/s, rwlock %4d reads/s",
+           thread_cnt, lock_rate, rwlock_rate);
+      if (thread_cnt >= 4 && rwlock_rate <= lock_rate)
+        fail ("rwlock no faster than lock with %d readers", thread_cnt);
+    }
+  pass ();
+}
+
+static void
+lock_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < READ_CNT; i++)
+    {
+      lock_acquire (&lock);
+      timer_sleep (1);
+      lock_release (&lock);
+    }
+  sema_up (&done);
+}
+
+static void
+rwlock_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < READ_CNT; i++)
+    {
+      rwlock_acquire_read (&rwlock);
+      timer_sleep (1);
+      rwlock_release_read (&rwlock);
+    }
+  sema_up (&done);
+}
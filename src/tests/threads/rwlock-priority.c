@@ -0,0 +1,73 @@
+/** Checks that a readers-writer lock admits waiting threads in
+   order of priority, and that a reader of higher priority than
+   a waiting writer does not wait for it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func reader_thread, writer_thread;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+void
+test_rwlock_priority (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+  thread_set_priority (PRI_MIN);
+
+  /* Writers of mixed priorities, and a reader that ties with one
+     of them and comes after it, wait for the main thread. */
+  rwlock_acquire_write (&rwlock);
+  for (i = 0; i < 5; i++)
+    {
+      int priority = PRI_DEFAULT - (i + 3) % 5 - 1;
+      char name[16];
+      snprintf (name, sizeof name, "writer %d", priority);
+      thread_create (name, priority, writer_thread, NULL);
+    }
+  thread_create ("reader 28", PRI_DEFAULT - 3, reader_thread, NULL);
+  timer_sleep (10);
+  msg ("Main thread releasing the lock.");
+  rwlock_release_write (&rwlock);
+  for (i = 0; i < 6; i++)
+    sema_down (&done);
+
+  /* A reader of high priority joins the main thread while a
+     writer of low priority waits. */
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer 21", PRI_DEFAULT - 10, writer_thread, NULL);
+  timer_sleep (10);
+  thread_create ("reader 41", PRI_DEFAULT + 10, reader_thread, NULL);
+  sema_down (&done);
+  msg ("Main thread releasing the lock.");
+  rwlock_release_read (&rwlock);
+  sema_down (&done);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("Thread %s acquired the lock.", thread_name ());
+  rwlock_release_read (&rwlock);
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("Thread %s acquired the lock.", thread_name ());
+  rwlock_release_write (&rwlock);
+  sema_up (&done);
+}
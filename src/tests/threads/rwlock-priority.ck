@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-priority) begin
+(rwlock-priority) Main thread releasing the lock.
+(rwlock-priority) Thread writer 30 acquired the lock.
+(rwlock-priority) Thread writer 29 acquired the lock.
+(rwlock-priority) Thread writer 28 acquired the lock.
+(rwlock-priority) Thread reader 28 acquired the lock.
+(rwlock-priority) Thread writer 27 acquired the lock.
+(rwlock-priority) Thread writer 26 acquired the lock.
+(rwlock-priority) Thread reader 41 acquired the lock.
+(rwlock-priority) Main thread releasing the lock.
+(rwlock-priority) Thread writer 21 acquired the lock.
+(rwlock-priority) end
+EOF
+pass;
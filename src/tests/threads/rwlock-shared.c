@@ -0,0 +1,71 @@
+/** Checks that several readers hold a readers-writer lock at
+   once, and that a writer waits until they have all released
+   it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 5
+
+static thread_func reader_thread, writer_thread;
+static struct rwlock rwlock;
+static struct semaphore inside;         /**< Upped by each reader inside. */
+static struct semaphore go;             /**< Lets a reader leave. */
+static struct semaphore done;           /**< Upped when the writer is done. */
+static bool writer_in;
+
+void
+test_rwlock_shared (void) 
+{
+  int i;
+
+  rwlock_init (&rwlock);
+  sema_init (&inside, 0);
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&inside);
+  msg ("%d readers hold the lock at once.", READER_CNT);
+
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  timer_sleep (10);
+  if (writer_in)
+    fail ("writer acquired the lock while readers held it");
+  msg ("Writer is waiting.");
+
+  msg ("Letting the readers go.");
+  for (i = 0; i < READER_CNT; i++)
+    sema_up (&go);
+  sema_down (&done);
+  msg ("Writer is done.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  sema_up (&inside);
+  sema_down (&go);
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  writer_in = true;
+  msg ("Writer acquired the lock.");
+  rwlock_release_write (&rwlock);
+  sema_up (&done);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-shared) begin
+(rwlock-shared) 5 readers hold the lock at once.
+(rwlock-shared) Writer is waiting.
+(rwlock-shared) Letting the readers go.
+(rwlock-shared) Writer acquired the lock.
+(rwlock-shared) Writer is done.
+(rwlock-shared) end
+EOF
+pass;
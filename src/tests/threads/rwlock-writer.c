@@ -0,0 +1,55 @@
+/** Checks that a reader does not pass a writer waiting for a
+   readers-writer lock, even though only readers hold the lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func reader_thread, writer_thread;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+void
+test_rwlock_writer (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  rwlock_acquire_read (&rwlock);
+  msg ("Main thread holds the lock for reading.");
+
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  timer_sleep (10);
+  thread_create ("reader", PRI_DEFAULT, reader_thread, NULL);
+  timer_sleep (10);
+
+  msg ("Main thread releasing the lock.");
+  rwlock_release_read (&rwlock);
+  sema_down (&done);
+  sema_down (&done);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  msg ("Reader waiting.");
+  rwlock_acquire_read (&rwlock);
+  msg ("Reader acquired the lock.");
+  rwlock_release_read (&rwlock);
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  msg ("Writer waiting.");
+  rwlock_acquire_write (&rwlock);
+  msg ("Writer acquired the lock.");
+  timer_sleep (10);
+  msg ("Writer releasing the lock.");
+  rwlock_release_write (&rwlock);
+  sema_up (&done);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Main thread holds the lock for reading.
+(rwlock-writer) Writer waiting.
+(rwlock-writer) Reader waiting.
+(rwlock-writer) Main thread releasing the lock.
+(rwlock-writer) Writer acquired the lock.
+(rwlock-writer) Writer releasing the lock.
+(rwlock-writer) Reader acquired the lock.
+(rwlock-writer) end
+EOF
+pass;
@@ -0,0 +1,93 @@
+/** Checks that readers of a record protected by a sequence lock
+   never see a write half done, although the writer yields the
+   CPU in the middle of each write. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 3
+#define WRITE_CNT 100
+
+/** A record whose members are always equal, outside a write. */
+struct record
+  {
+    int a;
+    int b;
+  };
+
+static thread_func reader_thread, writer_thread;
+static struct seqlock seqlock;
+static struct record record;
+static volatile bool writing;
+static struct semaphore done;
+
+void
+test_seqlock (void) 
+{
+  int i;
+
+  seqlock_init (&seqlock);
+  sema_init (&done, 0);
+  writing = true;
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&done);
+  msg ("Readers saw %d consistent records.", WRITE_CNT);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  int last = 0;
+
+  while (writing || last < WRITE_CNT)
+    {
+      struct record copy;
+      unsigned seq;
+
+      do
+        {
+          seq = seqlock_read_begin (&seqlock);
+          copy = record;
+        }
+      while (seqlock_read_retry (&seqlock, seq));
+
+      if (copy.a != copy.b)
+        fail ("%s read a torn record (%d, %d)",
+              thread_name (), copy.a, copy.b);
+      if (copy.a < last)
+        fail ("%s read record %d after record %d",
+              thread_name (), copy.a, last);
+      last = copy.a;
+      thread_yield ();
+    }
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 1; i <= WRITE_CNT; i++)
+    {
+      seqlock_write_begin (&seqlock);
+      record.a = i;
+      thread_yield ();
+      record.b = i;
+      seqlock_write_end (&seqlock);
+      thread_yield ();
+    }
+  writing = false;
+  sema_up (&done);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(seqlock) begin
+(seqlock) Readers saw 100 consistent records.
+(seqlock) end
+EOF
+pass;
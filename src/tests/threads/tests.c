@@ -29,6 +29,11 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"rwlock-shared", test_rwlock_shared},
+    {"rwlock-writer", test_rwlock_writer},
+    {"rwlock-priority", test_rwlock_priority},
+    {"rwlock-bench", test_rwlock_bench},
+    {"seqlock", test_seqlock},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -23,6 +23,11 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_rwlock_shared;
+extern test_func test_rwlock_writer;
+extern test_func test_rwlock_priority;
+extern test_func test_rwlock_bench;
+extern test_func test_seqlock;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
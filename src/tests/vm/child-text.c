@@ -0,0 +1,49 @@
+/** Child process of page-share-text.
+   Runs code from the whole of its text segment for a while, so
+   that all its siblings are resident at the same time. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-text";
+
+#define SIZE 4096
+#define ROUNDS 64
+
+static char buf[SIZE];
+
+int
+main (int argc, char *argv[])
+{
+  const char *key = argv[argc - 1];
+  unsigned long first_sum = 0;
+  size_t i;
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      struct arc4 arc4;
+      unsigned long sum;
+
+      /* Encrypt zeros, check the result is stable across rounds,
+         then decrypt back to zeros. */
+      arc4_init (&arc4, key, strlen (key));
+      arc4_crypt (&arc4, buf, SIZE);
+      sum = cksum (buf, SIZE);
+      if (i == 0)
+        first_sum = sum;
+      else if (sum != first_sum)
+        fail ("round %zu: checksum %lu != %lu", i, sum, first_sum);
+
+      arc4_init (&arc4, key, strlen (key));
+      arc4_crypt (&arc4, buf, SIZE);
+    }
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+
+  return 0x42;
+}
@@ -0,0 +1,72 @@
+/** Forks processes of increasing size and checks that parent and
+   child see separate copies of memory afterward.  Each child
+   exits right away, after one write, so the "Fork:" statistics
+   printed at shutdown show that only the written pages were
+   copied, however much memory the parent had touched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAX_PAGES 128
+#define FORK_CNT 4
+
+static char buf[MAX_PAGES * PAGE_SIZE];
+
+/** Checks that the first PAGE_CNT pages of BUF hold the pattern
+   written by fill(). */
+static void
+check (size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt * PAGE_SIZE; i++)
+    if (buf[i] != (char) (i / PAGE_SIZE + 1))
+      fail ("byte %zu is %d, expected %d",
+            i, buf[i], (char) (i / PAGE_SIZE + 1));
+}
+
+/** Writes a pattern to the first PAGE_CNT pages of BUF. */
+static void
+fill (size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt * PAGE_SIZE; i++)
+    buf[i] = i / PAGE_SIZE + 1;
+}
+
+void
+test_main (void)
+{
+  static const size_t sizes[] = {0, 8, 32, MAX_PAGES};
+  size_t i;
+  int j;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t page_cnt = sizes[i];
+
+      fill (page_cnt);
+      msg ("fork %d times with %zu pages touched", FORK_CNT, page_cnt);
+      for (j = 0; j < FORK_CNT; j++)
+        {
+          pid_t pid = fork ();
+          if (pid == 0)
+            {
+              /* Child: the parent's data is visible, and ours is
+                 about to become our own. */
+              check (page_cnt);
+              memset (buf, 0, PAGE_SIZE);
+              exit (0x42);
+            }
+          if (pid < 0)
+            fail ("fork failed");
+          if (wait (pid) != 0x42)
+            fail ("wrong exit code from child");
+        }
+      check (page_cnt);
+    }
+}
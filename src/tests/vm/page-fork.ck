@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-fork) begin
+(page-fork) fork 4 times with 0 pages touched
+(page-fork) fork 4 times with 8 pages touched
+(page-fork) fork 4 times with 32 pages touched
+(page-fork) fork 4 times with 128 pages touched
+(page-fork) end
+EOF
+
+# Each fork should copy only the few pages that the child or the
+# parent writes before the child exits, not the 0 to 128 pages
+# that the parent had touched: copying those would take at least
+# 4 * (8 + 32 + 128) = 672 copies.
+our ($test);
+my ($forks, $copies);
+for (read_text_file ("$test.output")) {
+    ($forks, $copies) = /^Fork: (\d+) forks, \d+ pages shared, (\d+) copied/
+      and last;
+}
+fail "missing \"Fork:\" statistics\n" if !defined $copies;
+fail "$copies pages copied on write in $forks forks\n"
+  if $copies > $forks * 8;
+pass;
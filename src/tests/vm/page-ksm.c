@@ -0,0 +1,52 @@
+/** Fills many pages with the same data, idles long enough for
+   the kernel's same-page merging scanner to merge them, then
+   writes to half of them and checks that every page still holds
+   what it should.  Writes to merged pages must unshare them
+   without disturbing the pages they were merged with. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/** Returns the byte expected at offset OFS in a page that has
+   been filled with the common pattern. */
+static char
+pattern (size_t ofs)
+{
+  return "same page merging "[ofs % 18];
+}
+
+void
+test_main (void)
+{
+  volatile unsigned spin;
+  size_t i, j;
+
+  msg ("fill");
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      buf[i][j] = pattern (j);
+
+  msg ("idle");
+  for (spin = 0; spin < 50000000; spin++)
+    continue;
+
+  msg ("write odd pages");
+  for (i = 1; i < PAGE_CNT; i += 2)
+    buf[i][i] = 'X';
+
+  msg ("check");
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      {
+        char expected = i % 2 && j == i ? 'X' : pattern (j);
+        if (buf[i][j] != expected)
+          fail ("page %zu byte %zu is '%c', expected '%c'",
+                i, j, buf[i][j], expected);
+      }
+}
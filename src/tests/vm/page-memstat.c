@@ -0,0 +1,53 @@
+/** Touches a block of pages until the kernel's working-set
+   sampler has seen all of them referenced, checking the paging
+   statistics that the memstat system call reports along the
+   way. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+void
+test_main (void)
+{
+  struct memstat ms;
+  volatile char *p;
+  size_t i, tries;
+
+  msg ("write pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (buf[i], i, PAGE_SIZE);
+  CHECK (memstat (&ms), "memstat");
+  if (ms.minor_faults == 0)
+    fail ("no minor faults counted for %d new pages", PAGE_CNT);
+
+  msg ("read until sampled");
+  for (tries = 0; ; tries++)
+    {
+      if (tries >= 100000)
+        fail ("working set is %u pages, expected at least %d",
+              ms.working_set, PAGE_CNT);
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          p = buf[i];
+          if (*p != (char) i)
+            fail ("page %zu has wrong contents", i);
+        }
+      memstat (&ms);
+      if (ms.working_set >= PAGE_CNT)
+        break;
+    }
+
+  if (ms.resident < ms.working_set)
+    fail ("%u pages resident, fewer than working set of %u",
+          ms.resident, ms.working_set);
+  if (ms.peak_working_set < ms.working_set)
+    fail ("peak working set %u below working set %u",
+          ms.peak_working_set, ms.working_set);
+}
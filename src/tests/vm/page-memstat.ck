@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-memstat) begin
+(page-memstat) write pages
+(page-memstat) memstat
+(page-memstat) read until sampled
+(page-memstat) end
+EOF
+pass;
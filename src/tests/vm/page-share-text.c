@@ -0,0 +1,24 @@
+/** Runs 8 child-text processes at once.  Their read-only code
+   pages are shared, so the peak number of frames in use, printed
+   as "Frames:" at shutdown, should be far below 8 times the size
+   of one child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK ((children[i] = exec ("child-text")) != -1,
+           "exec \"child-text\"");
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+}
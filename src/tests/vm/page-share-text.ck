@@ -0,0 +1,38 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-share-text) begin
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) exec "child-text"
+(page-share-text) wait for child 0
+(page-share-text) wait for child 1
+(page-share-text) wait for child 2
+(page-share-text) wait for child 3
+(page-share-text) wait for child 4
+(page-share-text) wait for child 5
+(page-share-text) wait for child 6
+(page-share-text) wait for child 7
+(page-share-text) end
+EOF
+
+# Each child-text has 4 pages of code and read-only data and 3
+# pages of its own.  Eight of them sharing their code need about
+# 4 + 8 * 3 = 28 frames, plus a few for this process; without
+# sharing, they would need 8 * 7 = 56.
+our ($test);
+my ($peak);
+for (read_text_file ("$test.output")) {
+    ($peak) = /^Frames: \d+ of \d+ in use \(peak (\d+)\)/ and last;
+}
+fail "missing \"Frames:\" statistics\n" if !defined $peak;
+fail "peak of $peak frames in use: child-text code not shared\n"
+  if $peak >= 48;
+pass;
@@ -0,0 +1,37 @@
+/** Reads all of a 16 MB static array, which is more than fits in
+   physical memory, then writes to a few of its pages.  Pages that
+   are only read stay mapped to the shared zero page, so the
+   reads need neither frames nor swap. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (16 * 1024 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read untouched pages");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu is %d, expected 0", i, buf[i]);
+
+  msg ("write every 64th page");
+  for (i = 0; i < SIZE; i += 64 * PAGE_SIZE)
+    memset (buf + i, i / PAGE_SIZE, PAGE_SIZE);
+
+  msg ("check");
+  for (i = 0; i < SIZE; i++)
+    {
+      size_t page = i / PAGE_SIZE;
+      char expected = page % 64 == 0 ? (char) page : 0;
+      if (buf[i] != expected)
+        fail ("byte %zu is %d, expected %d", i, buf[i], expected);
+    }
+}
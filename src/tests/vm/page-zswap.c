@@ -0,0 +1,75 @@
+/** Fills 4 MB of memory, more than fits in physical memory, with
+   a mix of pages that are all zeros, pages that compress well,
+   and pages of random data that do not compress at all, then
+   checks it all twice.  The kernel runs with a compressed swap
+   cache, so this exercises storing pages in the cache, reading
+   them back, spilling them to disk, and falling back to disk for
+   the pages that do not compress. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 1024
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/** Fills PAGE, the page with index IDX, with its expected
+   contents. */
+static void
+fill_page (char *page, size_t idx)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  switch (idx % 3)
+    {
+    case 0:
+      memset (page, 0, PAGE_SIZE);
+      break;
+
+    case 1:
+      for (i = 0; i < PAGE_SIZE; i++)
+        page[i] = "compressible "[i % 13] + idx;
+      break;
+
+    case 2:
+      memset (page, 0, PAGE_SIZE);
+      arc4_init (&arc4, &idx, sizeof idx);
+      arc4_crypt (&arc4, page, PAGE_SIZE);
+      break;
+    }
+}
+
+/** Checks that every page has the contents fill_page() gave it. */
+static void
+check_pages (void)
+{
+  static char expected[PAGE_SIZE];
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      fill_page (expected, i);
+      if (memcmp (buf[i], expected, PAGE_SIZE))
+        fail ("page %zu has wrong contents", i);
+    }
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("fill");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill_page (buf[i], i);
+
+  msg ("check");
+  check_pages ();
+
+  msg ("check again");
+  check_pages ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-zswap) begin
+(page-zswap) fill
+(page-zswap) check
+(page-zswap) check again
+(page-zswap) end
+EOF
+pass;
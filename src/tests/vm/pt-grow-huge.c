@@ -0,0 +1,25 @@
+/** Allocates a 4 MB object on the stack, far more than the one
+   page that a process starts with, and writes and checks every
+   page of it.  This must succeed. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (4 * 1024 * 1024)
+
+void
+test_main (void)
+{
+  char stk_obj[SIZE];
+  size_t i;
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    memset (stk_obj + i, i / PAGE_SIZE, PAGE_SIZE);
+  for (i = 0; i < SIZE; i++)
+    if (stk_obj[i] != (char) (i / PAGE_SIZE))
+      fail ("byte %zu is %d, expected %d",
+            i, stk_obj[i], (char) (i / PAGE_SIZE));
+  msg ("stack object checks out");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pt-grow-huge) begin
+(pt-grow-huge) stack object checks out
+(pt-grow-huge) end
+EOF
+pass;
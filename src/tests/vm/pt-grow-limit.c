@@ -0,0 +1,18 @@
+/** Allocates a stack object bigger than the 8 MB stack limit and
+   writes to its bottom byte, which is below the stack pointer
+   as it should be, but beyond how far the stack may grow.  The
+   process must be killed. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (9 * 1024 * 1024)
+
+void
+test_main (void)
+{
+  volatile char stk_obj[SIZE];
+
+  stk_obj[0] = 1;
+  fail ("wrote %d below the stack limit", stk_obj[0]);
+}
@@ -31,11 +31,20 @@
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /** Page directory with kernel mappings only. */
@@ -98,6 +107,10 @@ pintos_init (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef VM
+  frame_init ();
+  page_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -127,6 +140,13 @@ pintos_init (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap and start the paging daemons. */
+  swap_init ();
+  page_start_sampler ();
+  ksm_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   if (*argv != NULL) {
@@ -251,6 +271,12 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-wb-age"))
+        cache_dirty_age = atoi (value);
+      else if (!strcmp (name, "-extents"))
+        inode_use_extents = true;
+      else if (!strcmp (name, "-no-inline"))
+        inode_use_inline = false;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -263,6 +289,16 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-vmstat"))
+        page_exit_stats = true;
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-ksm"))
+        ksm_scan_rate = atoi (value);
+      else if (!strcmp (name, "-stack"))
+        stack_limit = (size_t) atoi (value) * 1024 * 1024;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -377,6 +413,9 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -wb-age=MS         Write back data dirty for MS ms (default 2000).\n"
+          "  -extents           Lay out new files as extents, not indexes.\n"
+          "  -no-inline         Store no file data in inodes.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
@@ -385,6 +424,12 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -vmstat            Print paging statistics as processes exit.\n"
+          "  -zswap=COUNT       Keep up to COUNT pages of compressed swap in RAM.\n"
+          "  -ksm=COUNT         Merge identical pages, scanning COUNT per 100 ms.\n"
+          "  -stack=MB          Let user stacks grow to MB megabytes (default 8).\n"
 #endif
           );
   shutdown_power_off ();
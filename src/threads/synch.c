@@ -336,3 +336,239 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/** A thread waiting for a readers-writer lock. */
+struct rwlock_waiter
+  {
+    struct list_elem elem;              /**< `waiters' element. */
+    struct thread *thread;              /**< The waiting thread. */
+    bool write;                         /**< Waiting to write? */
+    struct semaphore semaphore;         /**< Upped when admitted. */
+  };
+
+/** Returns true if waiter A_ has higher priority than B_. */
+static bool
+waiter_higher_priority (const struct list_elem *a_,
+                        const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct rwlock_waiter *a = list_entry (a_, struct rwlock_waiter, elem);
+  const struct rwlock_waiter *b = list_entry (b_, struct rwlock_waiter, elem);
+
+  return a->thread->priority > b->thread->priority;
+}
+
+/** Admits as many of RWLOCK's waiters as can hold it now.  The
+   caller must hold RWLOCK's `lock'. */
+static void
+rwlock_admit (struct rwlock *rwlock)
+{
+  while (rwlock->writer == NULL && !list_empty (&rwlock->waiters))
+    {
+      struct rwlock_waiter *w = list_entry (list_front (&rwlock->waiters),
+                                            struct rwlock_waiter, elem);
+      if (w->write)
+        {
+          if (rwlock->readers > 0)
+            break;
+          rwlock->writer = w->thread;
+        }
+      else
+        rwlock->readers++;
+      list_pop_front (&rwlock->waiters);
+      sema_up (&w->semaphore);
+    }
+}
+
+/** Acquires RWLOCK for writing if WRITE, otherwise for reading,
+   sleeping until admitted if necessary. */
+static void
+rwlock_acquire (struct rwlock *rwlock, bool write)
+{
+  struct rwlock_waiter w;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+  w.thread = thread_current ();
+  w.write = write;
+  sema_init (&w.semaphore, 0);
+
+  lock_acquire (&rwlock->lock);
+  list_insert_ordered (&rwlock->waiters, &w.elem,
+                       waiter_higher_priority, NULL);
+  rwlock_admit (rwlock);
+  lock_release (&rwlock->lock);
+
+  sema_down (&w.semaphore);
+}
+
+/** Initializes RWLOCK.  A readers-writer lock can be held by any
+   number of readers at once or by a single writer, but not by
+   readers and a writer at the same time.  It suits data that are
+   read much more often than they are changed, since readers do
+   not wait for one another.
+
+   Threads that must wait are admitted in order of priority, and
+   in the order they arrived among equal priorities.  A reader
+   never passes a waiting writer of the same or higher priority,
+   even while other readers hold the lock, so a steady stream of
+   readers cannot keep a writer out for long.  A reader of higher
+   priority than every waiting writer does get in.  Like a lock,
+   a readers-writer lock is not recursive. */
+void
+rwlock_init (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->lock);
+  list_init (&rwlock->waiters);
+  rwlock->readers = 0;
+  rwlock->writer = NULL;
+}
+
+/** Acquires RWLOCK for reading, sleeping until no writer holds it
+   or has precedence over the current thread if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock)
+{
+  rwlock_acquire (rwlock, false);
+}
+
+/** Releases RWLOCK, which the current thread must hold for
+   reading. */
+void
+rwlock_release_read (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->readers > 0);
+  if (--rwlock->readers == 0)
+    rwlock_admit (rwlock);
+  lock_release (&rwlock->lock);
+}
+
+/** Acquires RWLOCK for writing, sleeping until no reader or
+   writer holds it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock)
+{
+  rwlock_acquire (rwlock, true);
+}
+
+/** Releases RWLOCK, which the current thread must hold for
+   writing, and admits the waiting threads that come first: a
+   single writer, or every reader ahead of the first writer. */
+void
+rwlock_release_write (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock_held_by_current_thread (rwlock));
+
+  lock_acquire (&rwlock->lock);
+  rwlock->writer = NULL;
+  rwlock_admit (rwlock);
+  lock_release (&rwlock->lock);
+}
+
+/** Returns true if the current thread holds RWLOCK for writing,
+   false otherwise.  (Readers are not tracked individually.) */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  return rwlock->writer == thread_current ();
+}
+
+/** Initializes SEQLOCK.  A sequence lock protects a small record
+   that is read far more often than it is written, such as a
+   counter that an interrupt handler updates.  Its readers never
+   block and never make a writer wait.  Instead, a reader copies
+   the record and then checks whether a write overlapped the copy,
+   in which case it tries again:
+
+     unsigned seq;
+     do
+       {
+         seq = seqlock_read_begin (&seqlock);
+         ...copy the record...
+       }
+     while (seqlock_read_retry (&seqlock, seq));
+
+   The copy must not follow pointers in the record, which a
+   concurrent write could leave dangling.  Writers must exclude
+   one another by other means, for example by holding a lock or
+   by running in an interrupt handler. */
+void
+seqlock_init (struct seqlock *seqlock)
+{
+  ASSERT (seqlock != NULL);
+
+  seqlock->seq = 0;
+}
+
+/** Begins reading the record that SEQLOCK protects and returns
+   the value to pass to seqlock_read_retry().  If a writer is
+   partway through a write, yields the CPU until it finishes. */
+unsigned
+seqlock_read_begin (const struct seqlock *seqlock)
+{
+  unsigned seq;
+
+  ASSERT (seqlock != NULL);
+
+  for (;;)
+    {
+      seq = seqlock->seq;
+      barrier ();
+      if (seq % 2 == 0)
+        return seq;
+
+      /* An interrupt handler cannot wait for the thread it
+         interrupted to finish writing. */
+      ASSERT (!intr_context ());
+      thread_yield ();
+    }
+}
+
+/** Returns true if a write to the record that SEQLOCK protects
+   overlapped the read that seqlock_read_begin() began by
+   returning SEQ, in which case the read must be repeated. */
+bool
+seqlock_read_retry (const struct seqlock *seqlock, unsigned seq)
+{
+  ASSERT (seqlock != NULL);
+
+  barrier ();
+  return seqlock->seq != seq;
+}
+
+/** Begins a write to the record that SEQLOCK protects. */
+void
+seqlock_write_begin (struct seqlock *seqlock)
+{
+  ASSERT (seqlock != NULL);
+  ASSERT (seqlock->seq % 2 == 0);
+
+  seqlock->seq++;
+  barrier ();
+}
+
+/** Ends a write to the record that SEQLOCK protects. */
+void
+seqlock_write_end (struct seqlock *seqlock)
+{
+  ASSERT (seqlock != NULL);
+  ASSERT (seqlock->seq % 2 == 1);
+
+  barrier ();
+  seqlock->seq++;
+}
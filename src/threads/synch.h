@@ -41,6 +41,34 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/** Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /**< Protects the members below. */
+    struct list waiters;        /**< Waiting threads, by priority. */
+    unsigned readers;           /**< Number of readers holding it. */
+    struct thread *writer;      /**< Writer holding it, or null. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
+/** Sequence lock. */
+struct seqlock
+  {
+    unsigned seq;               /**< Odd while a write is under way. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /** Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -463,6 +463,17 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
+#ifdef USERPROG
+  t->exit_code = -1;
+  list_init (&t->children);
+  list_init (&t->fds);
+  t->next_handle = 2;
+#endif
+#ifdef VM
+  t->user_esp = PHYS_BASE;
+  list_init (&t->mappings);
+  t->next_mapid = 0;
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <memstat.h>
 #include <stdint.h>
 
 /** States in a thread's life cycle. */
@@ -96,6 +97,34 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /**< Page directory. */
+    int exit_code;                      /**< Exit code. */
+    struct wait_status *wait_status;    /**< This process's completion status. */
+    struct list children;               /**< Completion status of children. */
+
+    /* Owned by userprog/syscall.c. */
+    struct list fds;                    /**< List of file descriptors. */
+    int next_handle;                    /**< Next handle value. */
+#endif
+
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /**< Page table. */
+    struct file *bin_file;              /**< The binary executable. */
+    struct fault_around *fault_around;  /**< Fault-around state, or null. */
+    void *user_esp;                     /**< User %esp at last kernel entry. */
+    struct memstat memstat;             /**< Paging statistics. */
+    unsigned sample_resident;           /**< Working-set sample under way. */
+    unsigned sample_referenced;
+
+    /* Owned by userprog/syscall.c. */
+    struct list mappings;               /**< Memory-mapped files. */
+    int next_mapid;                     /**< Next memory mapping ID. */
+#endif
+
+#ifdef FILESYS
+    /* Owned by filesys/journal.c. */
+    int journal_depth;                  /**< Nested journal operations. */
+    size_t journal_cnt;                 /**< Log slots they reserved. */
 #endif
 
     /* Owned by thread.c. */
@@ -4,6 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /** Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,6 +152,35 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* A user fault below the stack pointer may be stack growth. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+
+  /* Let the pager bring the page in, if the process has one
+     there, or grow the stack. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && page_in (fault_addr, write))
+    return;
+
+  /* A write to a page that fork() left shared copy-on-write gets
+     a copy of its own. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && page_unshare (fault_addr))
+    return;
+#endif
+
+  /* A kernel access to user memory can only come from get_user()
+     or put_user() in userprog/syscall.c.  They keep the address
+     to resume at in %eax; resume there with %eax cleared to tell
+     them that the access failed. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0;
+      return;
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
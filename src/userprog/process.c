@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,43 +15,109 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/** Tracks the completion of a process.
+   Reference held by both the parent, in its `children' list,
+   and by the child, in its `wait_status' pointer. */
+struct wait_status
+  {
+    struct list_elem elem;              /**< `children' list element. */
+    struct lock lock;                   /**< Protects ref_cnt. */
+    int ref_cnt;                        /**< 2=child and parent both alive,
+                                           1=either child or parent alive,
+                                           0=child and parent both dead. */
+    tid_t tid;                          /**< Child thread id. */
+    int exit_code;                      /**< Child exit code, if dead. */
+    struct semaphore dead;              /**< 1=child alive, 0=child dead. */
+  };
+
+/** Data structure shared between process_execute() in the
+   invoking thread and start_process() in the newly invoked
+   thread. */
+struct exec_info
+  {
+    const char *file_name;              /**< Program to load. */
+    struct semaphore load_done;         /**< "Up"ed when loading complete. */
+    struct wait_status *wait_status;    /**< Child process. */
+    bool success;                       /**< Program successfully loaded? */
+  };
+
+/** Allocates and initializes a wait_status for the current
+   process, which has just been created by its parent.
+   Returns it, or a null pointer if memory is exhausted. */
+static struct wait_status *
+new_wait_status (void)
+{
+  struct thread *cur = thread_current ();
+  struct wait_status *cs = malloc (sizeof *cs);
+
+  if (cs != NULL)
+    {
+      lock_init (&cs->lock);
+      cs->ref_cnt = 2;
+      cs->tid = cur->tid;
+      cs->exit_code = -1;
+      sema_init (&cs->dead, 0);
+      cur->wait_status = cs;
+    }
+  return cs;
+}
+
 /** Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   thread id, or TID_ERROR if the thread cannot be created or the
+   program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_info exec;
+  char thread_name[16];
+  char *save_ptr;
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
-    return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  /* Initialize exec_info.  FILE_NAME stays valid until
+     start_process() is done with it, because we wait for it to
+     finish loading. */
+  exec.file_name = file_name;
+  sema_init (&exec.load_done, 0);
+
+  /* The thread is named after the program, without its
+     arguments. */
+  strlcpy (thread_name, file_name, sizeof thread_name);
+  strtok_r (thread_name, " ", &save_ptr);
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+  tid = thread_create (thread_name, PRI_DEFAULT, start_process, &exec);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&exec.load_done);
+      if (exec.success)
+        list_push_back (&thread_current ()->children, &exec.wait_status->elem);
+      else
+        tid = TID_ERROR;
+    }
+
   return tid;
 }
 
 /** A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *exec_)
 {
-  char *file_name = file_name_;
+  struct exec_info *exec = exec_;
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +126,18 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (exec->file_name, &if_.eip, &if_.esp);
+
+  /* Allocate wait_status. */
+  if (success)
+    {
+      exec->wait_status = new_wait_status ();
+      success = exec->wait_status != NULL;
+    }
 
-  /* If load failed, quit. */
-  palloc_free_page (file_name);
+  /* Notify parent thread and clean up. */
+  exec->success = success;
+  sema_up (&exec->load_done);
   if (!success) 
     thread_exit ();
 
@@ -76,18 +151,165 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/** Data structure shared between process_fork() in the parent
+   and start_fork() in the child. */
+struct fork_info
+  {
+    struct thread *parent;              /**< Process being forked. */
+    struct intr_frame if_;              /**< Parent's user registers. */
+    struct semaphore done;              /**< "Up"ed when copying complete. */
+    struct wait_status *wait_status;    /**< Child process. */
+    bool success;                       /**< Process successfully copied? */
+  };
+
+static thread_func start_fork NO_RETURN;
+
+/** Starts a new process that is a copy of the current one, which
+   entered the kernel with user registers IF_.  The child resumes
+   from the same point, with 0 as the system call's return value.
+   Its private pages are shared with the parent copy-on-write, so
+   the cost does not depend on how much memory the process has
+   touched.  Returns the child's thread id, or TID_ERROR if the
+   process cannot be copied. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct fork_info fork;
+  tid_t tid;
+
+  fork.parent = thread_current ();
+  fork.if_ = *if_;
+  sema_init (&fork.done, 0);
+
+  /* The parent stays blocked until the child has copied its
+     address space, which therefore cannot change meanwhile. */
+  tid = thread_create (thread_name (), PRI_DEFAULT, start_fork, &fork);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&fork.done);
+      if (fork.success)
+        list_push_back (&thread_current ()->children, &fork.wait_status->elem);
+      else
+        tid = TID_ERROR;
+    }
+
+  return tid;
+}
+
+/** Returns the current process's handle on the file that PARENT_
+   refers to as FILE. */
+static struct file *
+fork_file (struct file *file, void *parent_)
+{
+  struct thread *parent = parent_;
+
+  if (file == parent->bin_file)
+    return thread_current ()->bin_file;
+  return syscall_fork_file (parent, file);
+}
+
+/** Makes the current process a copy of PARENT.
+   Returns true if successful, false otherwise. */
+static bool
+copy_process (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+
+  /* Allocate and activate page directory. */
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    return false;
+  process_activate ();
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  hash_init (t->pages, page_hash, page_less, NULL);
+
+  /* Open the executable and the other files first, so that the
+     pages can refer to them. */
+  t->bin_file = file_reopen (parent->bin_file);
+  if (t->bin_file != NULL)
+    file_deny_write (t->bin_file);
+
+  return (t->bin_file != NULL
+          && syscall_fork (parent)
+          && page_fork (parent, fork_file, parent));
+}
+
+/** A thread function that copies the parent process and starts
+   running the copy. */
+static void
+start_fork (void *fork_)
+{
+  struct fork_info *fork = fork_;
+  struct intr_frame if_ = fork->if_;
+  bool success;
+
+  success = copy_process (fork->parent);
+
+  /* Allocate wait_status. */
+  if (success)
+    {
+      fork->wait_status = new_wait_status ();
+      success = fork->wait_status != NULL;
+    }
+
+  /* Notify parent thread and clean up. */
+  fork->success = success;
+  sema_up (&fork->done);
+  if (!success) 
+    thread_exit ();
+
+  /* Return to user mode as in start_process(), with fork()'s
+     return value in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+#endif
+
+/** Releases one reference to CS and, if it is now unreferenced,
+   frees it. */
+static void
+release_child (struct wait_status *cs)
+{
+  int new_ref_cnt;
+
+  lock_acquire (&cs->lock);
+  new_ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->lock);
+
+  if (new_ref_cnt == 0)
+    free (cs);
+}
+
 /** Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e))
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      if (cs->tid == child_tid)
+        {
+          int exit_code;
+          list_remove (e);
+          sema_down (&cs->dead);
+          exit_code = cs->exit_code;
+          release_child (cs);
+          return exit_code;
+        }
+    }
   return -1;
 }
 
@@ -96,8 +318,41 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
   uint32_t *pd;
 
+  if (cur->pagedir != NULL)
+    printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
+
+  /* Close open files and write back memory-mapped files. */
+  syscall_exit ();
+
+  /* Notify parent that we're dead. */
+  if (cur->wait_status != NULL)
+    {
+      struct wait_status *cs = cur->wait_status;
+      cs->exit_code = cur->exit_code;
+      sema_up (&cs->dead);
+      release_child (cs);
+    }
+
+  /* Free entries of children list. */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next)
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      next = list_remove (e);
+      release_child (cs);
+    }
+
+#ifdef VM
+  /* Release the process's pages and frames, then its
+     executable. */
+  page_exit ();
+  file_close (cur->bin_file);
+  cur->bin_file = NULL;
+#endif
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -195,24 +450,28 @@ struct Elf32_Phdr
 #define PF_W 2          /**< Writable. */
 #define PF_R 4          /**< Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (const char *cmd_line, void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/** Loads an ELF executable from FILE_NAME into the current thread.
+/** Loads an ELF executable named by the first word of CMD_LINE
+   into the current thread, passing it the words of CMD_LINE as
+   arguments.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *cmd_line, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
+  char file_name[NAME_MAX + 2];
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
   off_t file_ofs;
   bool success = false;
+  char *cp;
   int i;
 
   /* Allocate and activate page directory. */
@@ -220,6 +479,20 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    goto done;
+  hash_init (t->pages, page_hash, page_less, NULL);
+#endif
+
+  /* Extract file_name from command line. */
+  while (*cmd_line == ' ')
+    cmd_line++;
+  strlcpy (file_name, cmd_line, sizeof file_name);
+  cp = strchr (file_name, ' ');
+  if (cp != NULL)
+    *cp = '\0';
 
   /* Open executable file. */
   file = filesys_open (file_name);
@@ -228,6 +501,12 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", file_name);
       goto done; 
     }
+#ifdef VM
+  /* Pages are read from the executable on demand, so keep it
+     open, and unmodified, for as long as the process runs. */
+  t->bin_file = file;
+  file_deny_write (file);
+#endif
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -302,7 +581,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (cmd_line, esp))
     goto done;
 
   /* Start address. */
@@ -312,13 +591,17 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifndef VM
   file_close (file);
+#endif
   return success;
 }
 
 /** load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /** Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -387,7 +670,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -396,6 +681,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from; page_in() reads it
+         when the process first touches it. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0) 
+        {
+          /* Read-only pages never change, so every process
+             running this executable can share them through the
+             page cache. */
+          p->private = writable;
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,6 +718,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -424,26 +728,110 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
+/** Pushes the SIZE bytes in BUF onto the stack in the page at
+   UPAGE, whose page-relative stack pointer is *OFS, and then
+   adjusts *OFS appropriately.  The bytes pushed are rounded to a
+   32-bit boundary.
+   If successful, returns a pointer to the newly pushed object.
+   On failure, returns a null pointer. */
+static void *
+push (uint8_t *upage, size_t *ofs, const void *buf, size_t size)
+{
+  size_t padsize = ROUND_UP (size, sizeof (uint32_t));
+  if (*ofs < padsize)
+    return NULL;
+
+  *ofs -= padsize;
+  memcpy (upage + *ofs + (padsize - size), buf, size);
+  return upage + *ofs + (padsize - size);
+}
+
+/** Sets up command line arguments in UPAGE, which will be mapped
+   to the top of user virtual memory and must already be present
+   in the current address space.  Stores the initial stack
+   pointer into *ESP.
+   Returns true if successful, false if the arguments do not fit
+   in a page. */
+static bool
+init_cmd_line (uint8_t *upage, const char *cmd_line, void **esp)
+{
+  size_t ofs = PGSIZE;
+  char *const null = NULL;
+  char *cmd_line_copy;
+  char *karg, *saveptr;
+  int argc;
+  char **argv;
+  int i;
+
+  /* Push command line string. */
+  cmd_line_copy = push (upage, &ofs, cmd_line, strlen (cmd_line) + 1);
+  if (cmd_line_copy == NULL)
+    return false;
+
+  if (push (upage, &ofs, &null, sizeof null) == NULL)
+    return false;
+
+  /* Parse command line into arguments
+     and push them in reverse order. */
+  argc = 0;
+  for (karg = strtok_r (cmd_line_copy, " ", &saveptr); karg != NULL;
+       karg = strtok_r (NULL, " ", &saveptr))
+    {
+      if (push (upage, &ofs, &karg, sizeof karg) == NULL)
+        return false;
+      argc++;
+    }
+
+  /* Reverse the order of the command line arguments. */
+  argv = (char **) (upage + ofs);
+  for (i = 0; i < argc / 2; i++)
+    {
+      char *tmp = argv[i];
+      argv[i] = argv[argc - 1 - i];
+      argv[argc - 1 - i] = tmp;
+    }
+
+  /* Push argv, argc, "return address". */
+  if (push (upage, &ofs, &argv, sizeof argv) == NULL
+      || push (upage, &ofs, &argc, sizeof argc) == NULL
+      || push (upage, &ofs, &null, sizeof null) == NULL)
+    return false;
+
+  /* Set initial stack pointer. */
+  *esp = upage + ofs;
+  return true;
+}
+
 /** Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and pass the arguments in CMD_LINE on
+   it. */
 static bool
-setup_stack (void **esp) 
+setup_stack (const char *cmd_line, void **esp) 
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+#ifdef VM
+  struct page *page = page_allocate (upage, false);
+  if (page == NULL || !page_in (page->addr, true))
+    return false;
+  return init_cmd_line (upage, cmd_line, esp);
+#else
   uint8_t *kpage;
   bool success = false;
 
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      success = install_page (upage, kpage, true);
       if (success)
-        *esp = PHYS_BASE;
+        success = init_cmd_line (upage, cmd_line, esp);
       else
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /** Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +851,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
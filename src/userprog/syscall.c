@@ -1,20 +1,760 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "userprog/process.h"
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
+static void copy_in (void *, const void *, size_t);
+static bool copy_out (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+
+static void sys_halt (void) NO_RETURN;
+static void sys_exit (int status) NO_RETURN;
+static int sys_exec (const char *ufile);
+static int sys_wait (tid_t);
+static int sys_create (const char *ufile, unsigned initial_size);
+static int sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int handle);
+static int sys_read (int handle, void *udst, unsigned size);
+static int sys_write (int handle, const void *usrc, unsigned size);
+static int sys_seek (int handle, unsigned position);
+static int sys_tell (int handle);
+static int sys_close (int handle);
+static int sys_fsync (int handle);
+#ifdef VM
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static int sys_memstat (struct memstat *);
+#endif
+
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/** System call handler. */
+static void
+syscall_handler (struct intr_frame *f)
+{
+  unsigned call_nr;
+  int args[3];
+
+  /* Get the system call number and its arguments.  No call takes
+     more than three, and reading a few words too many is
+     harmless as long as they are in user memory. */
+#ifdef VM
+  /* Faults on user memory while we work may need the user stack
+     pointer to recognize stack growth. */
+  thread_current ()->user_esp = f->esp;
+#endif
+  copy_in (&call_nr, f->esp, sizeof call_nr);
+  memset (args, 0, sizeof args);
+  switch (call_nr)
+    {
+    case SYS_HALT:
+      sys_halt ();
+    case SYS_FORK:
+      break;
+    case SYS_EXIT:
+    case SYS_EXEC:
+    case SYS_WAIT:
+    case SYS_REMOVE:
+    case SYS_OPEN:
+    case SYS_FILESIZE:
+    case SYS_TELL:
+    case SYS_CLOSE:
+    case SYS_MUNMAP:
+    case SYS_MEMSTAT:
+    case SYS_FSYNC:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
+      break;
+    case SYS_CREATE:
+    case SYS_SEEK:
+    case SYS_MMAP:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 2);
+      break;
+    case SYS_READ:
+    case SYS_WRITE:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 3);
+      break;
+    default:
+      thread_exit ();
+    }
+
+  switch (call_nr)
+    {
+    case SYS_EXIT:
+      sys_exit (args[0]);
+    case SYS_EXEC:
+      f->eax = sys_exec ((const char *) args[0]);
+      break;
+    case SYS_WAIT:
+      f->eax = sys_wait (args[0]);
+      break;
+    case SYS_CREATE:
+      f->eax = sys_create ((const char *) args[0], args[1]);
+      break;
+    case SYS_REMOVE:
+      f->eax = sys_remove ((const char *) args[0]);
+      break;
+    case SYS_OPEN:
+      f->eax = sys_open ((const char *) args[0]);
+      break;
+    case SYS_FILESIZE:
+      f->eax = sys_filesize (args[0]);
+      break;
+    case SYS_READ:
+      f->eax = sys_read (args[0], (void *) args[1], args[2]);
+      break;
+    case SYS_WRITE:
+      f->eax = sys_write (args[0], (const void *) args[1], args[2]);
+      break;
+    case SYS_SEEK:
+      f->eax = sys_seek (args[0], args[1]);
+      break;
+    case SYS_TELL:
+      f->eax = sys_tell (args[0]);
+      break;
+    case SYS_CLOSE:
+      f->eax = sys_close (args[0]);
+      break;
+    case SYS_FSYNC:
+      f->eax = sys_fsync (args[0]);
+      break;
+#ifdef VM
+    case SYS_MMAP:
+      f->eax = sys_mmap (args[0], (void *) args[1]);
+      break;
+    case SYS_MUNMAP:
+      f->eax = sys_munmap (args[0]);
+      break;
+    case SYS_FORK:
+      f->eax = process_fork (f);
+      break;
+    case SYS_MEMSTAT:
+      f->eax = sys_memstat ((struct memstat *) args[0]);
+      break;
+#endif
+    default:
+      thread_exit ();
+    }
+}
+
+/** Copies a byte from user address USRC to kernel address DST.
+   USRC must be below PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static inline bool
+get_user (uint8_t *dst, const uint8_t *usrc)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
+       : "=m" (*dst), "=&a" (eax) : "m" (*usrc));
+  return eax != 0;
+}
+
+/** Writes BYTE to user address UDST.
+   UDST must be below PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static inline bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %b2, %0; 1:"
+       : "=m" (*udst), "=&a" (eax) : "q" (byte));
+  return eax != 0;
+}
+
+/** Copies SIZE bytes from user address USRC to kernel address
+   DST.
+   Call thread_exit() if any of the user accesses are invalid. */
+static void
+copy_in (void *dst_, const void *usrc_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  for (; size > 0; size--, dst++, usrc++)
+    if (!is_user_vaddr (usrc) || !get_user (dst, usrc))
+      thread_exit ();
+}
+
+/** Copies SIZE bytes from kernel address SRC to user address
+   UDST.
+   Returns true if successful, false if any of the user accesses
+   are invalid. */
+static bool
+copy_out (void *udst_, const void *src_, size_t size)
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  for (; size > 0; size--, udst++, src++)
+    if (!is_user_vaddr (udst) || !put_user (udst, *src))
+      return false;
+  return true;
+}
+
+/** Creates a copy of user string US in kernel memory
+   and returns it as a page that must be freed with
+   palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.
+   Call thread_exit() if any of the user accesses are invalid. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      if (!is_user_vaddr (us + length)
+          || !get_user ((uint8_t *) ks + length,
+                        (const uint8_t *) us + length))
+        {
+          palloc_free_page (ks);
+          thread_exit ();
+        }
+
+      if (ks[length] == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/** Halt system call. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+sys_halt (void)
 {
-  printf ("system call!\n");
+  shutdown_power_off ();
+}
+
+/** Exit system call. */
+static void
+sys_exit (int exit_code)
+{
+  thread_current ()->exit_code = exit_code;
   thread_exit ();
 }
+
+/** Exec system call. */
+static int
+sys_exec (const char *ufile)
+{
+  tid_t tid;
+  char *kfile = copy_in_string (ufile);
+
+  tid = process_execute (kfile);
+
+  palloc_free_page (kfile);
+
+  return tid;
+}
+
+/** Wait system call. */
+static int
+sys_wait (tid_t child)
+{
+  return process_wait (child);
+}
+
+/** Create system call. */
+static int
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok = filesys_create (kfile, initial_size);
+
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/** Remove system call. */
+static int
+sys_remove (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok = filesys_remove (kfile);
+
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/** A file descriptor, for binding a file handle to a file. */
+struct file_descriptor
+  {
+    struct list_elem elem;      /**< List element. */
+    struct file *file;          /**< File. */
+    int handle;                 /**< File handle. */
+  };
+
+/** Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  struct file_descriptor *fd;
+  int handle = -1;
+
+  fd = malloc (sizeof *fd);
+  if (fd != NULL)
+    {
+      fd->file = filesys_open (kfile);
+      if (fd->file != NULL)
+        {
+          struct thread *cur = thread_current ();
+          handle = fd->handle = cur->next_handle++;
+          list_push_front (&cur->fds, &fd->elem);
+        }
+      else
+        free (fd);
+    }
+
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/** Returns the file descriptor associated with the given handle.
+   Terminates the process if HANDLE is not associated with an
+   open file. */
+static struct file_descriptor *
+lookup_fd (int handle)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->fds); e != list_end (&cur->fds);
+       e = list_next (e))
+    {
+      struct file_descriptor *fd;
+      fd = list_entry (e, struct file_descriptor, elem);
+      if (fd->handle == handle)
+        return fd;
+    }
+
+  thread_exit ();
+}
+
+/** Filesize system call. */
+static int
+sys_filesize (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  return file_length (fd->file);
+}
+
+/** Read system call.
+
+   Data passes through a kernel buffer a page at a time, so that
+   no file system lock is held while touching user memory, which
+   may page fault. */
+static int
+sys_read (int handle, void *udst_, unsigned size)
+{
+  uint8_t *udst = udst_;
+  struct file_descriptor *fd;
+  uint8_t *buffer;
+  int bytes_read = 0;
+
+  /* Handle keyboard reads. */
+  if (handle == STDIN_FILENO)
+    {
+      for (bytes_read = 0; (size_t) bytes_read < size; bytes_read++)
+        {
+          uint8_t c = input_getc ();
+          if (!copy_out (udst + bytes_read, &c, 1))
+            thread_exit ();
+        }
+      return bytes_read;
+    }
+
+  /* Handle all other reads. */
+  fd = lookup_fd (handle);
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (size > 0)
+    {
+      size_t read_amt = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      retval = file_read (fd->file, buffer, read_amt);
+      if (retval < 0)
+        {
+          if (bytes_read == 0)
+            bytes_read = -1;
+          break;
+        }
+      if (!copy_out (udst + bytes_read, buffer, retval))
+        {
+          palloc_free_page (buffer);
+          thread_exit ();
+        }
+      bytes_read += retval;
+
+      /* If it was a short read we're done. */
+      if (retval != (off_t) read_amt)
+        break;
+
+      size -= retval;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_read;
+}
+
+/** Write system call. */
+static int
+sys_write (int handle, const void *usrc_, unsigned size)
+{
+  const uint8_t *usrc = usrc_;
+  struct file_descriptor *fd = NULL;
+  uint8_t *buffer;
+  int bytes_written = 0;
+
+  /* Lookup up file descriptor. */
+  if (handle != STDOUT_FILENO)
+    fd = lookup_fd (handle);
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (size > 0)
+    {
+      size_t write_amt = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      copy_in (buffer, usrc + bytes_written, write_amt);
+
+      /* Do the write. */
+      if (handle == STDOUT_FILENO)
+        {
+          putbuf ((char *) buffer, write_amt);
+          retval = write_amt;
+        }
+      else
+        retval = file_write (fd->file, buffer, write_amt);
+      if (retval < 0)
+        {
+          if (bytes_written == 0)
+            bytes_written = -1;
+          break;
+        }
+      bytes_written += retval;
+
+      /* If it was a short write we're done. */
+      if (retval != (off_t) write_amt)
+        break;
+
+      size -= retval;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_written;
+}
+
+/** Seek system call. */
+static int
+sys_seek (int handle, unsigned position)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  if ((off_t) position >= 0)
+    file_seek (fd->file, position);
+  return 0;
+}
+
+/** Tell system call. */
+static int
+sys_tell (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  return file_tell (fd->file);
+}
+
+/** Close system call. */
+static int
+sys_close (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  file_close (fd->file);
+  list_remove (&fd->elem);
+  free (fd);
+  return 0;
+}
+
+/** Fsync system call. */
+static int
+sys_fsync (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  file_sync (fd->file);
+  return 0;
+}
+
+#ifdef VM
+/** Binds a mapping id to a region of memory and a file. */
+struct mapping
+  {
+    struct list_elem elem;      /**< List element. */
+    int handle;                 /**< Mapping id. */
+    struct file *file;          /**< File. */
+    uint8_t *base;              /**< Start of memory mapping. */
+    size_t page_cnt;            /**< Number of pages mapped. */
+  };
+
+/** Returns the file descriptor associated with the given handle.
+   Terminates the process if HANDLE is not associated with a
+   memory mapping. */
+static struct mapping *
+lookup_mapping (int handle)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        return m;
+    }
+
+  thread_exit ();
+}
+
+/** Remove mapping M from the virtual address space,
+   writing back any pages that have changed. */
+static void
+unmap (struct mapping *m)
+{
+  /* Remove this mapping from the list of mappings for this
+     process. */
+  list_remove (&m->elem);
+
+  /* For each page in the memory mapped file... */
+  while (m->page_cnt-- > 0)
+    page_deallocate (m->base + m->page_cnt * PGSIZE);
+
+  file_close (m->file);
+  free (m);
+}
+
+/** Mmap system call.
+
+   The pages of a mapping are shared: every process that maps the
+   same part of the same file maps the same frame, through the
+   page cache in vm/frame.c, and stores to it reach the file when
+   it is unmapped, evicted, or its process exits. */
+static int
+sys_mmap (int handle, void *addr)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  struct mapping *m;
+  size_t offset;
+  off_t length;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  m->handle = thread_current ()->next_mapid++;
+  m->file = file_reopen (fd->file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return -1;
+    }
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&thread_current ()->mappings, &m->elem);
+
+  offset = 0;
+  length = file_length (m->file);
+  if (length == 0)
+    {
+      unmap (m);
+      return -1;
+    }
+  while (length > 0)
+    {
+      uint8_t *upage = (uint8_t *) addr + offset;
+      struct page *p;
+
+      if (!is_user_vaddr (upage)
+          || (p = page_allocate (upage, false)) == NULL)
+        {
+          unmap (m);
+          return -1;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = offset;
+      p->file_bytes = length >= PGSIZE ? PGSIZE : length;
+      offset += p->file_bytes;
+      length -= p->file_bytes;
+      m->page_cnt++;
+    }
+
+  return m->handle;
+}
+
+/** Munmap system call. */
+static int
+sys_munmap (int mapping)
+{
+  unmap (lookup_mapping (mapping));
+  return 0;
+}
+
+/** Memstat system call. */
+static int
+sys_memstat (struct memstat *udst)
+{
+  struct memstat ms;
+
+  page_get_stats (&ms);
+  if (!copy_out (udst, &ms, sizeof ms))
+    thread_exit ();
+  return true;
+}
+#endif
+
+/** Gives the current process, a child being forked from PARENT, a
+   copy of PARENT's file descriptors and of its list of memory
+   mappings, each with a handle of its own on the same file.  The
+   mapped pages themselves are copied by page_fork().
+   Returns true if successful, false if out of memory. */
+bool
+syscall_fork (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  bool success = true;
+
+  for (e = list_begin (&parent->fds); success && e != list_end (&parent->fds);
+       e = list_next (e))
+    {
+      struct file_descriptor *pfd, *cfd;
+      pfd = list_entry (e, struct file_descriptor, elem);
+      cfd = malloc (sizeof *cfd);
+      if (cfd != NULL && (cfd->file = file_reopen (pfd->file)) != NULL)
+        {
+          file_seek (cfd->file, file_tell (pfd->file));
+          cfd->handle = pfd->handle;
+          list_push_back (&cur->fds, &cfd->elem);
+        }
+      else
+        {
+          free (cfd);
+          success = false;
+        }
+    }
+  cur->next_handle = parent->next_handle;
+
+#ifdef VM
+  for (e = list_begin (&parent->mappings);
+       success && e != list_end (&parent->mappings); e = list_next (e))
+    {
+      struct mapping *pm, *cm;
+      pm = list_entry (e, struct mapping, elem);
+      cm = malloc (sizeof *cm);
+      if (cm != NULL && (cm->file = file_reopen (pm->file)) != NULL)
+        {
+          cm->handle = pm->handle;
+          cm->base = pm->base;
+          cm->page_cnt = pm->page_cnt;
+          list_push_back (&cur->mappings, &cm->elem);
+        }
+      else
+        {
+          free (cm);
+          success = false;
+        }
+    }
+  cur->next_mapid = parent->next_mapid;
+#endif
+  return success;
+}
+
+#ifdef VM
+/** Returns the current process's handle on the file that PARENT
+   maps through its handle FILE, after syscall_fork() copied
+   PARENT's mappings, or a null pointer if FILE is not one of
+   PARENT's mapped files. */
+struct file *
+syscall_fork_file (struct thread *parent, struct file *file)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *pe, *ce;
+
+  for (pe = list_begin (&parent->mappings), ce = list_begin (&cur->mappings);
+       pe != list_end (&parent->mappings) && ce != list_end (&cur->mappings);
+       pe = list_next (pe), ce = list_next (ce))
+    {
+      struct mapping *pm = list_entry (pe, struct mapping, elem);
+      struct mapping *cm = list_entry (ce, struct mapping, elem);
+      if (pm->file == file)
+        return cm->file;
+    }
+  return NULL;
+}
+#endif
+
+/** On thread exit, close all open files and unmap all
+   mappings. */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
+
+  for (e = list_begin (&cur->fds); e != list_end (&cur->fds); e = next)
+    {
+      struct file_descriptor *fd;
+      fd = list_entry (e, struct file_descriptor, elem);
+      next = list_next (e);
+      file_close (fd->file);
+      free (fd);
+    }
+  list_init (&cur->fds);
+
+#ifdef VM
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = next)
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      next = list_next (e);
+      unmap (m);
+    }
+#endif
+}
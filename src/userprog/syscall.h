@@ -1,6 +1,16 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct file;
+struct thread;
+
 void syscall_init (void);
+void syscall_exit (void);
+bool syscall_fork (struct thread *parent);
+#ifdef VM
+struct file *syscall_fork_file (struct thread *parent, struct file *);
+#endif
 
 #endif /**< userprog/syscall.h */
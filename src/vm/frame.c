@@ -0,0 +1,437 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/** Frame table.
+
+   Every page in the user pool is claimed at startup and handed
+   out from here, so the frames form one array in ascending
+   kernel virtual address order.  A frame with no pages mapped to
+   it is free.  A frame normally belongs to a single page, but a
+   frame in the page cache may be mapped by several processes. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/** Serializes frame allocation and eviction. */
+static struct lock scan_lock;
+
+/** Clock hand for eviction. */
+static size_t hand;
+
+/** Page cache: frames holding shared file data, indexed by inode
+   and offset. */
+static struct hash cache;
+
+/** Protects `cache'.  May be acquired while holding a frame's
+   lock, but not the other way around. */
+static struct lock cache_lock;
+
+/** Statistics, protected by stats_lock. */
+static struct lock stats_lock;
+static size_t resident_cnt;             /**< Frames now in use. */
+static size_t peak_cnt;                 /**< Maximum of resident_cnt. */
+static unsigned long long cache_hits;   /**< Pages mapped to a cached frame. */
+
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+static void count_resident (int delta);
+
+/** Initializes the frame manager. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  lock_init (&cache_lock);
+  lock_init (&stats_lock);
+  hash_init (&cache, cache_hash, cache_less, NULL);
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      list_init (&f->pages);
+      f->file = NULL;
+      f->ksm_sum = 0;
+      f->ksm_indexed = false;
+    }
+}
+
+/** Tries to find a free frame for PAGE, without evicting
+   anything.  The caller must hold scan_lock.
+   Returns the frame, locked, or a null pointer if every frame is
+   in use. */
+static struct frame *
+find_free_frame (struct page *page)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&scan_lock));
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!lock_try_acquire (&f->lock))
+        continue;
+      if (list_empty (&f->pages))
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          count_resident (1);
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+  return NULL;
+}
+
+/** Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  struct frame *f;
+  size_t i;
+
+  lock_acquire (&scan_lock);
+
+  /* Find a free frame. */
+  f = find_free_frame (page);
+  if (f != NULL)
+    {
+      lock_release (&scan_lock);
+      return f;
+    }
+
+  /* No free frame.  Find a frame to evict. */
+  for (i = 0; i < frame_cnt * 2; i++)
+    {
+      /* Get a frame. */
+      f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (!lock_try_acquire (&f->lock))
+        continue;
+
+      if (list_empty (&f->pages))
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          count_resident (1);
+          lock_release (&scan_lock);
+          return f;
+        }
+
+      /* On the first sweep, spare hot processes' frames too. */
+      if (page_accessed_recently (f) || (i < frame_cnt && page_hot (f)))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      lock_release (&scan_lock);
+
+      /* Evict this frame. */
+      if (!page_out (f))
+        {
+          lock_release (&f->lock);
+          return NULL;
+        }
+
+      list_push_back (&f->pages, &page->frame_elem);
+      return f;
+    }
+
+  lock_release (&scan_lock);
+  return NULL;
+}
+
+/** Tries really hard to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  size_t try;
+
+  for (try = 0; try < 3; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+      timer_msleep (1000);
+    }
+
+  return NULL;
+}
+
+/** Allocates and locks a frame for PAGE only if one is free
+   right now, for speculative uses such as read-ahead that are not
+   worth evicting anybody for.  Returns the frame if successful,
+   a null pointer otherwise. */
+struct frame *
+frame_try_alloc_free (struct page *page)
+{
+  struct frame *f;
+
+  lock_acquire (&scan_lock);
+  f = find_free_frame (page);
+  lock_release (&scan_lock);
+
+  return f;
+}
+
+/** Calls ACTION with each frame in use, locked, and AUX.  Frames
+   that are locked already are skipped, so this gives only an
+   approximate snapshot. */
+void
+frame_for_each (void (*action) (struct frame *, void *aux), void *aux)
+{
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!lock_try_acquire (&f->lock))
+        continue;
+      if (!list_empty (&f->pages))
+        action (f, aux);
+      lock_release (&f->lock);
+    }
+}
+
+/** Returns the number of frames. */
+size_t
+frame_count (void)
+{
+  return frame_cnt;
+}
+
+/** Returns frame number IDX, locked, if it is in use and no one
+   else has it locked, otherwise a null pointer. */
+struct frame *
+frame_try_lock_nth (size_t idx)
+{
+  struct frame *f = &frames[idx];
+
+  ASSERT (idx < frame_cnt);
+
+  if (!lock_try_acquire (&f->lock))
+    return NULL;
+  if (list_empty (&f->pages))
+    {
+      lock_release (&f->lock);
+      return NULL;
+    }
+  return f;
+}
+
+/** Returns the frame whose kernel virtual base address is KPAGE,
+   or a null pointer if KPAGE is not a user frame. */
+struct frame *
+frame_for_kpage (const void *kpage)
+{
+  size_t idx;
+
+  if (frame_cnt == 0 || (const uint8_t *) kpage < (uint8_t *) frames[0].base)
+    return NULL;
+
+  idx = ((const uint8_t *) kpage - (uint8_t *) frames[0].base) / PGSIZE;
+  if (idx >= frame_cnt || frames[idx].base != kpage)
+    return NULL;
+  return &frames[idx];
+}
+
+/** Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, or replaced by another
+     by same-page merging, but never inserted. */
+  for (;;)
+    {
+      struct frame *f = p->frame;
+      if (f == NULL)
+        return;
+      lock_acquire (&f->lock);
+      if (f == p->frame)
+        return;
+      lock_release (&f->lock);
+    }
+}
+
+/** Releases frame F for use by another page.
+   F must be locked for use by the current process, and no page
+   may still be mapped to it.
+   Any data in F is lost. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (list_empty (&f->pages));
+  ASSERT (f->file == NULL);
+
+  count_resident (-1);
+  lock_release (&f->lock);
+}
+
+/** Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/** Looks for a frame in the page cache that holds the data that
+   page P maps from its file.  If there is one, locks it, maps P
+   to it, and returns it.  Otherwise, returns a null pointer. */
+struct frame *
+frame_cache_lookup_and_lock (struct page *p)
+{
+  struct frame key;
+
+  key.file = p->file;
+  key.file_offset = p->file_offset;
+  key.file_bytes = p->file_bytes;
+
+  for (;;)
+    {
+      struct hash_elem *e;
+      struct frame *f;
+
+      lock_acquire (&cache_lock);
+      e = hash_find (&cache, &key.cache_elem);
+      f = e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+      lock_release (&cache_lock);
+      if (f == NULL)
+        return NULL;
+
+      /* The frame may have been evicted, or even reused for some
+         other file data, before we got its lock. */
+      lock_acquire (&f->lock);
+      if (f->file != NULL
+          && !cache_less (&key.cache_elem, &f->cache_elem, NULL)
+          && !cache_less (&f->cache_elem, &key.cache_elem, NULL))
+        {
+          list_push_back (&f->pages, &p->frame_elem);
+          lock_acquire (&stats_lock);
+          cache_hits++;
+          lock_release (&stats_lock);
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+}
+
+/** Enters frame F, which must be locked, into the page cache as
+   holding FILE_BYTES bytes of FILE starting at FILE_OFFSET.
+   FILE becomes owned by the page cache.
+   Returns true if successful, false if some other frame already
+   caches the same data, in which case FILE is left to the
+   caller. */
+bool
+frame_cache_insert (struct frame *f, struct file *file,
+                    off_t file_offset, off_t file_bytes)
+{
+  bool success;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->file == NULL);
+
+  f->file = file;
+  f->file_offset = file_offset;
+  f->file_bytes = file_bytes;
+  f->dirty = false;
+
+  lock_acquire (&cache_lock);
+  success = hash_insert (&cache, &f->cache_elem) == NULL;
+  lock_release (&cache_lock);
+
+  if (!success)
+    f->file = NULL;
+  return success;
+}
+
+/** Removes frame F, which must be locked, from the page cache.
+   Returns F's file handle, which the caller must close. */
+struct file *
+frame_cache_remove (struct frame *f)
+{
+  struct file *file = f->file;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (file != NULL);
+
+  lock_acquire (&cache_lock);
+  hash_delete (&cache, &f->cache_elem);
+  lock_release (&cache_lock);
+
+  f->file = NULL;
+  return file;
+}
+
+/** Adds DELTA to the count of frames in use. */
+static void
+count_resident (int delta)
+{
+  lock_acquire (&stats_lock);
+  resident_cnt += delta;
+  if (resident_cnt > peak_cnt)
+    peak_cnt = resident_cnt;
+  lock_release (&stats_lock);
+}
+
+/** Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu of %zu in use (peak %zu), %llu page cache hits\n",
+          resident_cnt, frame_cnt, peak_cnt, cache_hits);
+}
+
+/** Returns a hash value for the file data cached in frame E. */
+static unsigned
+cache_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, cache_elem);
+  struct inode *inode = file_get_inode (f->file);
+
+  return hash_bytes (&inode, sizeof inode) ^ hash_int (f->file_offset);
+}
+
+/** Returns true if the file data cached in frame A_ orders before
+   that in frame B_. */
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+  const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+  struct inode *a_inode = file_get_inode (a->file);
+  struct inode *b_inode = file_get_inode (b->file);
+
+  if (a_inode != b_inode)
+    return a_inode < b_inode;
+  else if (a->file_offset != b->file_offset)
+    return a->file_offset < b->file_offset;
+  else
+    return a->file_bytes < b->file_bytes;
+}
@@ -0,0 +1,54 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct page;
+
+/** A physical frame. */
+struct frame
+  {
+    struct lock lock;           /**< Prevent simultaneous access. */
+    void *base;                 /**< Kernel virtual base address. */
+    struct list pages;          /**< Pages mapped to this frame. */
+
+    /* Page cache.  Set while the frame holds file data shared by
+       every process that maps that part of the file. */
+    struct file *file;          /**< Our own handle on the file, or null. */
+    off_t file_offset;          /**< Offset in file. */
+    off_t file_bytes;           /**< Bytes of file data, 1...PGSIZE. */
+    bool dirty;                 /**< Written since last write-back? */
+    struct hash_elem cache_elem; /**< Page cache element. */
+
+    /* Same-page merging, used only by the scanner thread. */
+    unsigned ksm_sum;           /**< Checksum at the last scan. */
+    bool ksm_indexed;           /**< In the scanner's index? */
+    struct hash_elem ksm_elem;  /**< Scanner's index element. */
+  };
+
+void frame_init (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+struct frame *frame_try_alloc_free (struct page *);
+struct frame *frame_for_kpage (const void *kpage);
+void frame_for_each (void (*action) (struct frame *, void *aux), void *aux);
+size_t frame_count (void);
+struct frame *frame_try_lock_nth (size_t idx);
+void frame_lock (struct page *);
+
+void frame_free (struct frame *);
+void frame_unlock (struct frame *);
+
+struct frame *frame_cache_lookup_and_lock (struct page *);
+bool frame_cache_insert (struct frame *, struct file *,
+                         off_t file_offset, off_t file_bytes);
+struct file *frame_cache_remove (struct frame *);
+
+void frame_print_stats (void);
+
+#endif /**< vm/frame.h */
@@ -0,0 +1,313 @@
+#include "vm/ksm.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/** Same-page merging.
+
+   Many processes may hold identical data in private memory, such
+   as tables built at startup or buffers filled the same way.  A
+   kernel thread looks for private frames with identical contents
+   and merges them into a single frame.  Their pages then share
+   that frame copy-on-write, just as after fork(): the first write
+   to any of them faults, and page_unshare() gives the writer a
+   copy of its own.
+
+   Every KSM_SLEEP_MS milliseconds the scanner examines the next
+   ksm_scan_rate frames, going around the frame table.  A frame is
+   a candidate for merging only if:
+
+     - it is private, not in the page cache;
+
+     - none of its pages has been accessed since the scanner last
+       looked at it.  Hot pages would likely be unshared again
+       right away;
+
+     - its checksum has not changed since the last scan.  Frames
+       whose data is still changing are not worth write-protecting.
+
+   Candidates are indexed by checksum in `stable'.  When another
+   candidate has the same checksum, the scanner write-protects
+   both frames, which keeps their data from changing further, and
+   compares them byte by byte.  If they are the same, it merges
+   the new candidate into the indexed one.
+
+   Only the scanner thread touches `stable' and the ksm_* members
+   of struct frame.  A frame in `stable' may have been freed or
+   reused since it was indexed.  That is harmless, because a frame
+   is always checked again before anything is merged into it. */
+
+/** -ksm: Frames to scan per KSM_SLEEP_MS, or 0 to disable. */
+size_t ksm_scan_rate;
+
+#define KSM_SLEEP_MS 100
+
+/** Candidate frames, indexed by checksum. */
+static struct hash stable;
+
+/** Statistics. */
+static unsigned long long scan_cnt;     /**< Frames scanned. */
+static unsigned long long merge_cnt;    /**< Frames merged away. */
+static unsigned long long share_cnt;    /**< Frames that took them in. */
+
+static thread_func scanner;
+static hash_hash_func stable_hash;
+static hash_less_func stable_less;
+
+/** Starts the same-page merging scanner, if the -ksm option
+   asked for it. */
+void
+ksm_init (void)
+{
+  if (ksm_scan_rate == 0)
+    return;
+
+  hash_init (&stable, stable_hash, stable_less, NULL);
+  thread_create ("ksm", PRI_DEFAULT, scanner, NULL);
+}
+
+/** Prints same-page merging statistics. */
+void
+ksm_print_stats (void)
+{
+  if (ksm_scan_rate == 0)
+    return;
+
+  printf ("KSM: %llu frames scanned, %llu pages merged "
+          "into %llu shared frames\n", scan_cnt, merge_cnt, share_cnt);
+}
+
+/** Returns true if locked frame F holds private, writable pages
+   that could share a frame copy-on-write. */
+static bool
+mergeable (struct frame *f)
+{
+  struct list_elem *e;
+
+  if (f->file != NULL || list_empty (&f->pages))
+    return false;
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (p->read_only)
+        return false;
+    }
+  return true;
+}
+
+/** Returns true if any page mapped to locked frame F has been
+   accessed since the last look, clearing their accessed bits.
+   The references are kept in the pages' `referenced' members for
+   the clock's sake. */
+static bool
+accessed_recently (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_accessed (p->thread->pagedir, p->addr))
+        {
+          pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+          p->referenced = true;
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/** Maps every page of locked frame F read-only, so that its data
+   cannot change without a fault. */
+static void
+write_protect (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      pagedir_set_writable (p->thread->pagedir, p->addr, false);
+    }
+}
+
+/** Makes every page of locked frame F anonymous if it has been
+   written since it was read from its file. */
+static void
+detach_files (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    page_detach_file (list_entry (e, struct page, frame_elem));
+}
+
+/** Moves every page of frame SRC over to frame DST, which holds
+   the same data, and frees SRC.  Both frames must be locked and
+   write-protected; DST stays locked. */
+static void
+merge (struct frame *src, struct frame *dst)
+{
+  detach_files (src);
+  detach_files (dst);
+  if (list_front (&dst->pages) == list_back (&dst->pages))
+    share_cnt++;
+
+  while (!list_empty (&src->pages))
+    {
+      struct page *p = list_entry (list_pop_front (&src->pages),
+                                   struct page, frame_elem);
+      uint32_t *pd = p->thread->pagedir;
+
+      /* Clearing the mapping keeps the page table, so mapping the
+         page again cannot fail for lack of memory.  If it did
+         fail anyway, the next access would fault the page back
+         in from DST. */
+      pagedir_clear_page (pd, p->addr);
+      p->frame = dst;
+      list_push_back (&dst->pages, &p->frame_elem);
+      pagedir_set_page (pd, p->addr, dst->base, false);
+      merge_cnt++;
+    }
+  frame_free (src);
+}
+
+/** Adds frame F to `stable'. */
+static void
+index_frame (struct frame *f)
+{
+  ASSERT (!f->ksm_indexed);
+  hash_insert (&stable, &f->ksm_elem);
+  f->ksm_indexed = true;
+}
+
+/** Removes frame F from `stable', if it is there. */
+static void
+unindex_frame (struct frame *f)
+{
+  if (f->ksm_indexed)
+    {
+      hash_delete (&stable, &f->ksm_elem);
+      f->ksm_indexed = false;
+    }
+}
+
+/** Scans locked frame F, merging it into an identical frame if
+   there is one, and unlocks or frees it. */
+static void
+scan_frame (struct frame *f)
+{
+  struct hash_elem *e;
+  struct frame *g;
+  unsigned sum;
+
+  scan_cnt++;
+  if (!mergeable (f) || accessed_recently (f))
+    {
+      frame_unlock (f);
+      return;
+    }
+
+  sum = hash_bytes (f->base, PGSIZE);
+  if (sum != f->ksm_sum)
+    {
+      /* Changed since the last scan.  Try again next time. */
+      unindex_frame (f);
+      f->ksm_sum = sum;
+      frame_unlock (f);
+      return;
+    }
+
+  e = hash_find (&stable, &f->ksm_elem);
+  g = e != NULL ? hash_entry (e, struct frame, ksm_elem) : NULL;
+  if (g == f)
+    {
+      frame_unlock (f);
+      return;
+    }
+  if (g == NULL)
+    {
+      index_frame (f);
+      frame_unlock (f);
+      return;
+    }
+
+  /* F and G are locked in no particular order, so only try. */
+  if (!lock_try_acquire (&g->lock))
+    {
+      frame_unlock (f);
+      return;
+    }
+
+  if (mergeable (g))
+    {
+      write_protect (f);
+      write_protect (g);
+      if (!memcmp (f->base, g->base, PGSIZE))
+        {
+          ASSERT (!f->ksm_indexed);
+          merge (f, g);
+          frame_unlock (g);
+          return;
+        }
+    }
+
+  /* G no longer holds the data it was indexed for.  Let F take
+     its place. */
+  unindex_frame (g);
+  frame_unlock (g);
+  index_frame (f);
+  frame_unlock (f);
+}
+
+/** Scanner thread. */
+static void
+scanner (void *aux UNUSED)
+{
+  size_t cursor = 0;
+
+  for (;;)
+    {
+      size_t i;
+
+      timer_msleep (KSM_SLEEP_MS);
+      for (i = 0; i < ksm_scan_rate && frame_count () > 0; i++)
+        {
+          struct frame *f = frame_try_lock_nth (cursor);
+          if (++cursor >= frame_count ())
+            cursor = 0;
+          if (f != NULL)
+            scan_frame (f);
+        }
+    }
+}
+
+/** Returns the hash value for frame E in `stable'. */
+static unsigned
+stable_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct frame, ksm_elem)->ksm_sum;
+}
+
+/** Returns true if frame A_'s checksum is less than B_'s. */
+static bool
+stable_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, ksm_elem);
+  const struct frame *b = hash_entry (b_, struct frame, ksm_elem);
+
+  return a->ksm_sum < b->ksm_sum;
+}
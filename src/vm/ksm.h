@@ -0,0 +1,11 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+
+#include <stddef.h>
+
+extern size_t ksm_scan_rate;
+
+void ksm_init (void);
+void ksm_print_stats (void);
+
+#endif /**< vm/ksm.h */
@@ -0,0 +1,1260 @@
+#include "vm/page.h"
+#include <memstat.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+static struct page *page_for_addr (const void *address);
+static void read_ahead_swap (struct page *, block_sector_t sector);
+static void release_frame (struct page *);
+static void fault_around (struct page *, bool write);
+static bool map_ahead (void *upage, bool write);
+
+/** A page of zeros, mapped read-only in place of every anonymous
+   page that has not been written yet.  The first write to such a
+   page faults and gets it a frame of its own. */
+static void *zero_page;
+
+/** If true, print each process's paging statistics when it
+   exits.  Controlled by kernel command-line option "-vmstat". */
+bool page_exit_stats;
+
+/** Fault-around.
+
+   Each fault maps not only the faulting page but, once a process
+   has been seen faulting sequentially through a region, up to a
+   window's worth of the pages after it: pages that are resident
+   but unmapped, that are in the page cache, or that can be read
+   into a frame that is free right now.  A process may stream
+   through several regions at once, so it tracks a few streams.
+   The pages mapped ahead have their accessed bits clear, so the
+   next fault in the stream can tell how many of them were used
+   and grow or shrink the window to match. */
+#define FAULT_STREAMS 4         /**< Streams tracked per process. */
+#define FAULT_AROUND_MIN 2      /**< Initial window, in pages. */
+#define FAULT_AROUND_MAX 32     /**< Maximum window, in pages. */
+
+/** A sequential stream of page faults. */
+struct fault_stream
+  {
+    uint8_t *base;              /**< First page mapped ahead last time. */
+    uint8_t *next;              /**< Expected next fault, just past them. */
+    size_t window;              /**< Pages to map ahead. */
+  };
+
+/** A process's fault-around state. */
+struct fault_around
+  {
+    struct fault_stream streams[FAULT_STREAMS];
+    size_t hand;                /**< Stream to replace next. */
+    unsigned long long mapped;  /**< Pages mapped ahead. */
+    unsigned long long avoided; /**< Of those, pages later accessed. */
+  };
+
+/** Stack growth.
+
+   A fault on an address that no page covers is taken as stack
+   growth if it lies within stack_limit bytes of PHYS_BASE and no
+   more than PUSHA_REACH bytes below the user stack pointer, the
+   farthest below %esp that PUSHA writes.  The faulting page gets
+   an anonymous page, and so do the pages above it up to whatever
+   is mapped already, at most STACK_GROW_BATCH of them.  Those
+   are then mapped ahead as by fault-around, because a fault far
+   below the rest of the stack usually means a large object that
+   is about to be filled in. */
+#define PUSHA_REACH 32
+#define STACK_GROW_BATCH 8
+
+/** Maximum size of a user stack, in bytes.  Controlled by kernel
+   command-line option "-stack". */
+size_t stack_limit = 8 * 1024 * 1024;
+
+/** Working-set sampling.
+
+   A kernel thread wakes up every WS_SAMPLE_MS milliseconds and
+   walks the frame table, counting each process's resident pages
+   and, by testing and clearing their accessed bits, the ones it
+   has referenced since the last pass: its working set.  So that
+   the clock does not lose the references whose bits the sampler
+   cleared, it records them in the pages' `referenced' members.
+
+   A process that referenced at least HOT_PERCENT percent of its
+   resident pages in the last interval is "hot".  The clock
+   passes over hot processes' frames on its first sweep, so that
+   frames are taken from cold processes first. */
+#define WS_SAMPLE_MS 100
+#define HOT_PERCENT 50
+
+/** Statistics, protected by stats_lock.  So are the `evictions'
+   counts in each thread's `memstat', which other processes
+   update; the rest of `memstat' is updated only by the process
+   itself, except for the working-set members, which only the
+   sampler thread updates. */
+static struct lock stats_lock;
+static unsigned long long fork_cnt;     /**< Processes forked. */
+static unsigned long long cow_share_cnt; /**< Frames shared by fork(). */
+static unsigned long long cow_copy_cnt; /**< Frames copied on write. */
+static unsigned long long ahead_cnt;    /**< Pages mapped by fault-around. */
+static unsigned long long avoided_cnt;  /**< Faults fault-around avoided. */
+static unsigned long long zero_map_cnt; /**< Pages mapped to zero_page. */
+
+/** Initializes the page table module. */
+void
+page_init (void)
+{
+  lock_init (&stats_lock);
+
+  zero_page = palloc_get_page (PAL_ZERO);
+  if (zero_page == NULL)
+    PANIC ("out of memory allocating zero page");
+}
+
+/** Prints page table statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Fork: %llu forks, %llu pages shared, %llu copied on write\n",
+          fork_cnt, cow_share_cnt, cow_copy_cnt);
+  printf ("Fault-around: %llu pages mapped ahead, %llu faults avoided\n",
+          ahead_cnt, avoided_cnt);
+  printf ("Zero page: %llu pages mapped\n", zero_map_cnt);
+}
+
+/** Adds locked frame F to the working-set sample under way for
+   each process that maps it. */
+static void
+sample_frame (struct frame *f, void *aux UNUSED)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      struct thread *t = p->thread;
+
+      t->sample_resident++;
+      if (pagedir_is_accessed (t->pagedir, p->addr))
+        {
+          pagedir_set_accessed (t->pagedir, p->addr, false);
+          p->referenced = true;
+          t->sample_referenced++;
+        }
+    }
+}
+
+/** Makes the sample just taken of thread T's working set the
+   current one. */
+static void
+publish_sample (struct thread *t, void *aux UNUSED)
+{
+  struct memstat *ms = &t->memstat;
+
+  ms->resident = t->sample_resident;
+  ms->working_set = t->sample_referenced;
+  if (ms->working_set > ms->peak_working_set)
+    ms->peak_working_set = ms->working_set;
+  t->sample_resident = t->sample_referenced = 0;
+}
+
+/** Working-set sampler thread. */
+static void
+sampler (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+
+      timer_msleep (WS_SAMPLE_MS);
+      frame_for_each (sample_frame, NULL);
+
+      /* A thread's struct cannot go away while interrupts are
+         off. */
+      old_level = intr_disable ();
+      thread_foreach (publish_sample, NULL);
+      intr_set_level (old_level);
+    }
+}
+
+/** Starts sampling processes' working sets. */
+void
+page_start_sampler (void)
+{
+  thread_create ("ws-sampler", PRI_DEFAULT, sampler, NULL);
+}
+
+/** Stores the current process's paging statistics into MS. */
+void
+page_get_stats (struct memstat *ms)
+{
+  lock_acquire (&stats_lock);
+  *ms = thread_current ()->memstat;
+  lock_release (&stats_lock);
+}
+
+/** Destroys a page, which must be in the current process's
+   page table.  Used as a callback for hash_destroy(). */
+static void
+destroy_page (struct hash_elem *p_, void *aux UNUSED)
+{
+  struct page *p = hash_entry (p_, struct page, hash_elem);
+  frame_lock (p);
+  if (p->frame)
+    release_frame (p);
+  swap_free (p);
+  free (p);
+}
+
+/** Destroys the current process's page table. */
+void
+page_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct fault_around *fa = t->fault_around;
+
+  if (t->pages != NULL)
+    {
+      if (page_exit_stats)
+        {
+          struct memstat ms;
+
+          page_get_stats (&ms);
+          printf ("%s: %u pages resident, working set %u (peak %u), "
+                  "%llu minor and %llu major faults, %llu evictions, "
+                  "%llu swap-ins\n",
+                  t->name, ms.resident, ms.working_set,
+                  ms.peak_working_set, ms.minor_faults, ms.major_faults,
+                  ms.evictions, ms.swap_ins);
+        }
+      hash_destroy (t->pages, destroy_page);
+      free (t->pages);
+      t->pages = NULL;
+    }
+
+  if (fa != NULL)
+    {
+      if (page_exit_stats)
+        printf ("%s: fault-around mapped %llu pages, avoided %llu faults\n",
+                t->name, fa->mapped, fa->avoided);
+      lock_acquire (&stats_lock);
+      ahead_cnt += fa->mapped;
+      avoided_cnt += fa->avoided;
+      lock_release (&stats_lock);
+      free (fa);
+      t->fault_around = NULL;
+    }
+}
+
+/** Returns the page containing the given virtual ADDRESS,
+   or a null pointer if no such page exists. */
+static struct page *
+page_for_addr (const void *address)
+{
+  struct hash *h = thread_current ()->pages;
+  struct page p;
+  struct hash_elem *e;
+
+  if (h == NULL || !is_user_vaddr (address))
+    return NULL;
+
+  p.addr = (void *) pg_round_down (address);
+  e = hash_find (h, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/** If a fault at ADDRESS, for which the current process has no
+   page, is stack growth, gives the process pages for the stack
+   from ADDRESS upward, as described above, and stores their
+   number into *CNT.  Returns the page for ADDRESS, or a null
+   pointer if ADDRESS is not on the stack or memory is short. */
+static struct page *
+grow_stack (const void *address, size_t *cnt)
+{
+  struct thread *t = thread_current ();
+  uint8_t *upage = pg_round_down (address);
+  struct page *p;
+  size_t i;
+
+  if ((uintptr_t) PHYS_BASE - (uintptr_t) upage > stack_limit
+      || (uintptr_t) address + PUSHA_REACH < (uintptr_t) t->user_esp)
+    return NULL;
+
+  p = page_allocate (upage, false);
+  if (p == NULL)
+    return NULL;
+  for (i = 1; i < STACK_GROW_BATCH; i++)
+    {
+      uint8_t *q = upage + i * PGSIZE;
+      if (!is_user_vaddr (q) || page_for_addr (q) != NULL
+          || page_allocate (q, false) == NULL)
+        break;
+    }
+  *cnt = i;
+  return p;
+}
+
+/** Returns true if page P has never held any data, so that its
+   contents are all zeros.  P's frame, if any, must be locked. */
+static bool
+page_untouched (const struct page *p)
+{
+  return (p->frame == NULL && p->file == NULL
+          && p->sector == (block_sector_t) -1);
+}
+
+/** Maps untouched page P to the zero page, read-only.
+   Returns true if successful, false on failure. */
+static bool
+map_zero_page (struct page *p)
+{
+  if (!pagedir_set_page (p->thread->pagedir, p->addr, zero_page, false))
+    return false;
+
+  lock_acquire (&stats_lock);
+  zero_map_cnt++;
+  lock_release (&stats_lock);
+  return true;
+}
+
+/** Returns true if page P is mapped to the zero page in its
+   process's page table. */
+static bool
+page_is_zero_mapped (const struct page *p)
+{
+  return pagedir_get_page (p->thread->pagedir, p->addr) == zero_page;
+}
+
+/** Returns true if page P, which must have a locked frame, may be
+   mapped writable.  A private frame mapped by more than one page
+   is shared copy-on-write, so it is mapped read-only until a
+   write fault gives the writer a copy of its own. */
+static bool
+page_writable (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  return (!p->read_only
+          && (f->file != NULL
+              || list_front (&f->pages) == list_back (&f->pages)));
+}
+
+/** Reads page P's data from its file into frame F and zeroes the
+   rest of the frame. */
+static void
+read_file_page (struct page *p, struct frame *f)
+{
+  off_t read_bytes, zero_bytes;
+
+  read_bytes = file_read_at (p->file, f->base, p->file_bytes, p->file_offset);
+  zero_bytes = PGSIZE - read_bytes;
+  memset ((uint8_t *) f->base + read_bytes, 0, zero_bytes);
+  if (read_bytes != p->file_bytes)
+    printf ("bytes read (%"PROTd") != bytes requested (%"PROTd")\n",
+            read_bytes, p->file_bytes);
+}
+
+/** Allocates and locks a frame for page P.  If SPECULATIVE, only
+   takes a frame that is free right now.  Returns the frame, or a
+   null pointer if none could be had. */
+static struct frame *
+alloc_frame (struct page *p, bool speculative)
+{
+  return speculative ? frame_try_alloc_free (p) : frame_alloc_and_lock (p);
+}
+
+/** Maps shared file page P to the page cache frame for its data,
+   reading the data into a new frame, allocated as by
+   alloc_frame(), if no process has it in memory yet, in which
+   case *MAJOR is set to true.  Returns the frame, locked, or a
+   null pointer if no frame could be had. */
+static struct frame *
+map_shared_page (struct page *p, bool speculative, bool *major)
+{
+  for (;;)
+    {
+      struct frame *f;
+      struct file *file;
+
+      f = frame_cache_lookup_and_lock (p);
+      if (f != NULL)
+        return f;
+
+      f = alloc_frame (p, speculative);
+      if (f == NULL)
+        return NULL;
+      read_file_page (p, f);
+      *major = true;
+
+      file = file_reopen (p->file);
+      if (file != NULL
+          && frame_cache_insert (f, file, p->file_offset, p->file_bytes))
+        return f;
+
+      /* Out of memory, or another process read the same data in
+         while we were reading it.  In the latter case, use its
+         frame instead. */
+      list_remove (&p->frame_elem);
+      frame_free (f);
+      if (file == NULL)
+        return NULL;
+      file_close (file);
+    }
+}
+
+/** Locks a frame for page P and pages it in.  If SPECULATIVE,
+   the page is wanted only for fault-around, so only a frame that
+   is free right now will do.  Sets *MAJOR to true if the data
+   had to be read from disk.
+   Returns true if successful, false on failure. */
+static bool
+do_page_in (struct page *p, bool speculative, bool *major)
+{
+  block_sector_t sector = p->sector;
+
+  /* Another process may already have a shared file page's data in
+     memory. */
+  if (p->file != NULL && !p->private)
+    {
+      p->frame = map_shared_page (p, speculative, major);
+      return p->frame != NULL;
+    }
+
+  /* Get a frame for the page. */
+  p->frame = alloc_frame (p, speculative);
+  if (p->frame == NULL)
+    return false;
+
+  /* Copy data into the frame. */
+  if (sector != (block_sector_t) -1)
+    {
+      /* Get data from swap, and its cluster-mates with it. */
+      swap_in (p, speculative);
+      p->thread->memstat.swap_ins++;
+      *major = true;
+      if (!speculative)
+        read_ahead_swap (p, sector);
+    }
+  else if (p->file != NULL)
+    {
+      /* Get data from file. */
+      read_file_page (p, p->frame);
+      *major = true;
+    }
+  else
+    {
+      /* Provide all-zero page. */
+      memset (p->frame->base, 0, PGSIZE);
+    }
+
+  return true;
+}
+
+/** Brings in the up to SWAP_READ_AHEAD pages that follow P in
+   the address space, provided swap_out() placed them in the
+   slots right after the one P was just read from (passed as
+   SECTOR).  Such reads continue the sequential run on the swap
+   device and so are cheap.  Only frames that are free right now
+   are used: it is not worth evicting anything for a guess. */
+static void
+read_ahead_swap (struct page *p, block_sector_t sector)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  for (i = 1; i <= SWAP_READ_AHEAD; i++)
+    {
+      struct page *q = page_for_addr ((uint8_t *) p->addr + i * PGSIZE);
+      block_sector_t q_sector = sector + i * (PGSIZE / BLOCK_SECTOR_SIZE);
+      struct frame *f;
+
+      /* Q's frame can only be set in this context, so a null
+         frame stays null while we work on Q. */
+      if (q == NULL || q->frame != NULL || q->sector != q_sector)
+        break;
+
+      f = frame_try_alloc_free (q);
+      if (f == NULL)
+        break;
+      q->frame = f;
+      swap_in (q, true);
+      q->thread->memstat.swap_ins++;
+
+      /* Map it with the accessed bit clear, so that the clock
+         reclaims it first if the guess was wrong. */
+      if (!pagedir_set_page (pd, q->addr, f->base, !q->read_only))
+        {
+          list_remove (&q->frame_elem);
+          q->frame = NULL;
+          frame_free (f);
+          break;
+        }
+      frame_unlock (f);
+    }
+}
+
+/** Faults in the page containing FAULT_ADDR.  WRITE is true if
+   the fault was a write, in which case a page that has never been
+   written gets a frame of its own instead of the zero page.
+   Returns true if successful, false on failure. */
+bool
+page_in (void *fault_addr, bool write)
+{
+  struct memstat *ms = &thread_current ()->memstat;
+  struct page *p;
+  size_t grow_cnt = 0;
+  bool major = false;
+  bool success;
+  size_t i;
+
+  p = page_for_addr (fault_addr);
+  if (p == NULL)
+    p = grow_stack (fault_addr, &grow_cnt);
+  if (p == NULL)
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL)
+    {
+      if (!write && page_untouched (p))
+        {
+          success = map_zero_page (p);
+          if (success)
+            {
+              ms->minor_faults++;
+              fault_around (p, write);
+            }
+          return success;
+        }
+      if (!do_page_in (p, false, &major))
+        return false;
+    }
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Install frame into page table. */
+  success = pagedir_set_page (thread_current ()->pagedir, p->addr,
+                              p->frame->base, page_writable (p));
+
+  /* Release frame. */
+  frame_unlock (p->frame);
+
+  if (success)
+    {
+      if (major)
+        ms->major_faults++;
+      else
+        ms->minor_faults++;
+      for (i = 1; i < grow_cnt; i++)
+        if (!map_ahead ((uint8_t *) p->addr + i * PGSIZE, write))
+          break;
+      fault_around (p, write);
+    }
+  return success;
+}
+
+/** Maps the page at UPAGE, which must not be mapped, for
+   fault-around, if the process has a page there that can be
+   brought in cheaply.  The mapping has its accessed bit clear.
+   WRITE is true if the stream is one of writes, so that mapping
+   an untouched page to the zero page would only cost another
+   fault.
+   Returns true if successful, false otherwise. */
+static bool
+map_ahead (void *upage, bool write)
+{
+  struct page *q = page_for_addr (upage);
+  bool major;
+  bool success;
+
+  if (q == NULL)
+    return false;
+
+  frame_lock (q);
+  if (!write && page_untouched (q))
+    return map_zero_page (q);
+  if (q->frame == NULL && !do_page_in (q, true, &major))
+    return false;
+  success = pagedir_set_page (thread_current ()->pagedir, q->addr,
+                              q->frame->base, page_writable (q));
+  q->referenced = false;
+  frame_unlock (q->frame);
+  return success;
+}
+
+/** Adjusts stream S's window according to how many of the pages
+   it mapped ahead last time have since been accessed, and
+   credits those to FA. */
+static void
+adapt_window (struct fault_around *fa, struct fault_stream *s)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t run = (s->next - s->base) / PGSIZE;
+  size_t hits = 0;
+  uint8_t *upage;
+
+  for (upage = s->base; upage < s->next; upage += PGSIZE)
+    {
+      struct page *q = page_for_addr (upage);
+      if (pagedir_is_accessed (pd, upage)
+          || (q != NULL && q->referenced))
+        hits++;
+    }
+  fa->avoided += hits;
+
+  if (s->window == 0)
+    s->window = FAULT_AROUND_MIN;
+  else if (hits == run && run == s->window)
+    s->window = s->window * 2 < FAULT_AROUND_MAX ? s->window * 2
+                                                  : FAULT_AROUND_MAX;
+  else if (hits * 2 < run)
+    s->window = s->window / 2 > FAULT_AROUND_MIN ? s->window / 2
+                                                  : FAULT_AROUND_MIN;
+}
+
+/** Called after page P has been faulted in, to map the pages
+   after it ahead of time if P's fault continues a sequential
+   stream.  WRITE is true if P's fault was a write. */
+static void
+fault_around (struct page *p, bool write)
+{
+  struct thread *t = thread_current ();
+  struct fault_around *fa = t->fault_around;
+  struct fault_stream *s;
+  uint8_t *upage;
+  size_t i;
+
+  if (fa == NULL)
+    {
+      fa = t->fault_around = calloc (1, sizeof *fa);
+      if (fa == NULL)
+        return;
+    }
+
+  /* Find the stream that expected this fault, or else start a
+     new one, replacing the oldest. */
+  for (i = 0; i < FAULT_STREAMS; i++)
+    if (fa->streams[i].next == p->addr)
+      break;
+  if (i >= FAULT_STREAMS)
+    {
+      s = &fa->streams[fa->hand++ % FAULT_STREAMS];
+      s->base = s->next = (uint8_t *) p->addr + PGSIZE;
+      s->window = 0;
+      return;
+    }
+  s = &fa->streams[i];
+  adapt_window (fa, s);
+
+  /* Map ahead.  Pages already mapped, for instance by swap
+     read-ahead, count as part of the run. */
+  s->base = (uint8_t *) p->addr + PGSIZE;
+  for (upage = s->base, i = 0;
+       i < s->window && is_user_vaddr (upage); upage += PGSIZE, i++)
+    {
+      if (pagedir_get_page (t->pagedir, upage) != NULL)
+        continue;
+      if (!map_ahead (upage, write))
+        break;
+      fa->mapped++;
+    }
+  s->next = upage;
+}
+
+/** Writes page cache frame F back to its file if any page mapped
+   to it has modified it since the last write-back.  F must be
+   locked.  Returns true if successful, false on failure. */
+static bool
+flush_shared_frame (struct frame *f)
+{
+  struct list_elem *e;
+  bool dirty = f->dirty;
+  bool ok = true;
+
+  /* Collect and clear the dirty bits before writing, so that a
+     store by a mapper that sneaks in meanwhile sets them again
+     and is not lost. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_dirty (p->thread->pagedir, p->addr))
+        {
+          pagedir_set_dirty (p->thread->pagedir, p->addr, false);
+          dirty = true;
+        }
+    }
+  f->dirty = false;
+
+  if (dirty)
+    {
+      ok = (file_write_at (f->file, f->base, f->file_bytes, f->file_offset)
+            == f->file_bytes);
+      if (!ok)
+        f->dirty = true;
+    }
+  return ok;
+}
+
+/** Takes page cache frame F, which must be locked, out of the page
+   cache and closes the file it held open. */
+static void
+uncache_frame (struct frame *f)
+{
+  struct file *file = frame_cache_remove (f);
+
+  file_close (file);
+}
+
+/** Unmaps page P from its frame, which must be locked.  The frame
+   is freed unless some other page still maps it.  A page cache
+   frame is written back to its file first if it was modified. */
+static void
+release_frame (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  if (f->file != NULL)
+    flush_shared_frame (f);
+
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+  if (!list_empty (&f->pages))
+    {
+      frame_unlock (f);
+      return;
+    }
+
+  if (f->file != NULL)
+    uncache_frame (f);
+  frame_free (f);
+}
+
+/** Locks the page at ADDR in P's address space for inclusion in
+   P's swap-out cluster.  Only a page that is resident, not in the
+   page cache, has not been accessed recently, and would itself go
+   to swap qualifies.
+   Returns the page, with its frame locked and its mapping
+   cleared, or a null pointer.
+
+   P's frame must be locked by the caller.  That keeps P's owner
+   from getting through page_exit(), so its page directory stays
+   valid while we look at it. */
+static struct page *
+lock_cluster_page (struct page *p, const void *addr)
+{
+  uint32_t *pd = p->thread->pagedir;
+  struct frame *f;
+  struct page *q;
+  void *kpage;
+
+  kpage = pagedir_get_page (pd, addr);
+  if (kpage == NULL || pagedir_is_accessed (pd, addr))
+    return NULL;
+
+  f = frame_for_kpage (kpage);
+  if (f == NULL || !lock_try_acquire (&f->lock))
+    return NULL;
+
+  if (f->file != NULL || list_empty (&f->pages)
+      || list_front (&f->pages) != list_back (&f->pages))
+    {
+      lock_release (&f->lock);
+      return NULL;
+    }
+
+  q = list_entry (list_front (&f->pages), struct page, frame_elem);
+  if (q->thread != p->thread || q->addr != addr
+      || (q->file != NULL && !pagedir_is_dirty (pd, addr)))
+    {
+      lock_release (&f->lock);
+      return NULL;
+    }
+
+  pagedir_clear_page (pd, q->addr);
+  return q;
+}
+
+/** Evicts page P to swap along with as many of its unused
+   neighbours as fit in a cluster, so that they go out in one
+   sequential burst.  P's frame must be locked and P must already
+   be unmapped.  Returns true if P was swapped out. */
+static bool
+swap_out_cluster (struct page *p)
+{
+  struct page *cluster[SWAP_CLUSTER];
+  size_t below, cnt, i;
+  uint8_t *addr;
+
+  /* Gather neighbours below P, then P, then neighbours above P,
+     so that the cluster is in ascending address order. */
+  below = 0;
+  for (addr = (uint8_t *) p->addr - PGSIZE;
+       below < SWAP_CLUSTER - 1 && addr >= (uint8_t *) PGSIZE;
+       addr -= PGSIZE)
+    {
+      struct page *q = lock_cluster_page (p, addr);
+      if (q == NULL)
+        break;
+      cluster[SWAP_CLUSTER - 2 - below++] = q;
+    }
+  memmove (cluster, cluster + SWAP_CLUSTER - 1 - below,
+           below * sizeof *cluster);
+  cnt = below;
+  cluster[cnt++] = p;
+
+  for (addr = (uint8_t *) p->addr + PGSIZE;
+       cnt < SWAP_CLUSTER && is_user_vaddr (addr); addr += PGSIZE)
+    {
+      struct page *q = lock_cluster_page (p, addr);
+      if (q == NULL)
+        break;
+      cluster[cnt++] = q;
+    }
+
+  if (swap_out (cluster, cnt))
+    {
+      /* Give the neighbours' frames back for reuse. */
+      for (i = 0; i < cnt; i++)
+        if (cluster[i] != p)
+          {
+            struct frame *f = cluster[i]->frame;
+            list_remove (&cluster[i]->frame_elem);
+            cluster[i]->frame = NULL;
+            frame_free (f);
+          }
+      return true;
+    }
+
+  /* Swap is too fragmented or full for the whole cluster.  Leave
+     the neighbours resident; they will be remapped on their next
+     access. */
+  for (i = 0; i < cnt; i++)
+    if (cluster[i] != p)
+      frame_unlock (cluster[i]->frame);
+  return cnt > 1 && swap_out (&p, 1);
+}
+
+/** Evicts page cache frame F, writing it back to its file first
+   if it was modified.  F must be locked.
+   Return true if successful, false on failure. */
+static bool
+evict_shared_frame (struct frame *f)
+{
+  struct list_elem *e;
+
+  /* Unmap it everywhere before looking at the dirty bits, for the
+     same reason as in page_out(). */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+    }
+
+  if (!flush_shared_frame (f))
+    return false;
+
+  while (!list_empty (&f->pages))
+    {
+      struct page *p = list_entry (list_pop_front (&f->pages),
+                                   struct page, frame_elem);
+      p->frame = NULL;
+    }
+  uncache_frame (f);
+  return true;
+}
+
+/** Evicts private frame F, which is shared copy-on-write by more
+   than one page.  F must be locked.
+   Return true if successful, false on failure. */
+static bool
+evict_cow_frame (struct frame *f)
+{
+  struct list_elem *e;
+  bool anonymous = false;
+
+  /* The mappings are all read-only, so the data cannot change
+     under us once they are gone. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      if (p->file == NULL)
+        anonymous = true;
+    }
+
+  /* Unless it can be reread from the file, write it to one swap
+     slot that all of the pages share. */
+  if (anonymous && !swap_out_frame (f))
+    return false;
+
+  while (!list_empty (&f->pages))
+    {
+      struct page *p = list_entry (list_pop_front (&f->pages),
+                                   struct page, frame_elem);
+      p->frame = NULL;
+    }
+  return true;
+}
+
+/** Evicts private frame F, which is mapped by a single page.
+   F must be locked.
+   Return true if successful, false on failure. */
+static bool
+evict_private_frame (struct frame *f)
+{
+  struct page *p = list_entry (list_front (&f->pages),
+                               struct page, frame_elem);
+  bool dirty;
+  bool ok = false;
+
+  /* Mark page not present in page table, forcing accesses by the
+     process to fault.  This must happen before checking the
+     dirty bit, to prevent a race with the process dirtying the
+     page. */
+  pagedir_clear_page (p->thread->pagedir, (void *) p->addr);
+
+  /* Has the frame been modified? */
+  dirty = pagedir_is_dirty (p->thread->pagedir, (const void *) p->addr);
+
+  /* A clean page that came from a file can simply be reread from
+     it; anything else must be saved to swap. */
+  if (p->file == NULL || dirty)
+    ok = swap_out_cluster (p);
+  else
+    ok = true;
+
+  if (ok)
+    {
+      list_remove (&p->frame_elem);
+      p->frame = NULL;
+    }
+  return ok;
+}
+
+/** Adds DELTA to the eviction count of each process that maps
+   frame F, which must be locked. */
+static void
+count_evictions (struct frame *f, int delta)
+{
+  struct list_elem *e;
+
+  lock_acquire (&stats_lock);
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      p->thread->memstat.evictions += delta;
+    }
+  lock_release (&stats_lock);
+}
+
+/** Evicts the page or pages mapped to frame F.
+   F must be locked.
+   Return true if successful, false on failure. */
+bool
+page_out (struct frame *f)
+{
+  bool ok;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (!list_empty (&f->pages));
+
+  /* Charge the processes that lose the frame.  If eviction fails,
+     they are all still on F's list to take the charge back. */
+  count_evictions (f, 1);
+  if (f->file != NULL)
+    ok = evict_shared_frame (f);
+  else if (list_front (&f->pages) != list_back (&f->pages))
+    ok = evict_cow_frame (f);
+  else
+    ok = evict_private_frame (f);
+  if (!ok)
+    count_evictions (f, -1);
+  return ok;
+}
+
+/** Returns true if any page mapped to frame F has been accessed
+   recently, false otherwise, clearing their accessed bits.
+   F must be locked. */
+bool
+page_accessed_recently (struct frame *f)
+{
+  struct list_elem *e;
+  bool was_accessed = false;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_accessed (p->thread->pagedir, p->addr))
+        {
+          pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+          was_accessed = true;
+        }
+      if (p->referenced)
+        {
+          p->referenced = false;
+          was_accessed = true;
+        }
+    }
+  return was_accessed;
+}
+
+/** Returns true if any process that maps frame F, which must be
+   locked, is hot, that is, if it referenced at least HOT_PERCENT
+   percent of its resident pages in the last sampling interval. */
+bool
+page_hot (struct frame *f)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      const struct memstat *ms = &p->thread->memstat;
+      if (ms->resident > 0
+          && ms->working_set * 100 >= ms->resident * HOT_PERCENT)
+        return true;
+    }
+  return false;
+}
+
+/** Handles a write fault on the page containing FAULT_ADDR, which
+   must be present but read-only in the page table.  If the page
+   is writable but shares a private frame copy-on-write, gives it
+   a copy of its own, or just makes it writable if it turns out
+   to be the last page using the frame.
+   Returns true if successful, false if the write is not allowed
+   or memory is exhausted. */
+bool
+page_unshare (void *fault_addr)
+{
+  struct page *p = page_for_addr (fault_addr);
+  struct frame *old, *new;
+
+  if (p == NULL || p->read_only)
+    return false;
+
+  frame_lock (p);
+  old = p->frame;
+  if (old == NULL)
+    {
+      /* Mapped to the zero page, or evicted since the fault.
+         Either way, bring it in for writing, which gives it a
+         frame of its own. */
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      return page_in (fault_addr, true);
+    }
+  if (old->file != NULL)
+    {
+      frame_unlock (old);
+      return false;
+    }
+
+  if (list_front (&old->pages) == list_back (&old->pages))
+    {
+      /* The other sharers are gone. */
+      pagedir_set_writable (p->thread->pagedir, p->addr, true);
+      frame_unlock (old);
+      p->thread->memstat.minor_faults++;
+      return true;
+    }
+
+  /* Copy the data into a new frame.  OLD stays locked meanwhile,
+     so the allocator cannot choose it for eviction. */
+  list_remove (&p->frame_elem);
+  new = frame_alloc_and_lock (p);
+  if (new == NULL)
+    {
+      list_push_back (&old->pages, &p->frame_elem);
+      frame_unlock (old);
+      return false;
+    }
+  memcpy (new->base, old->base, PGSIZE);
+  p->frame = new;
+  frame_unlock (old);
+
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  pagedir_set_page (p->thread->pagedir, p->addr, new->base, true);
+  frame_unlock (new);
+
+  p->thread->memstat.minor_faults++;
+  lock_acquire (&stats_lock);
+  cow_copy_cnt++;
+  lock_release (&stats_lock);
+  return true;
+}
+
+/** Makes page P, which must have a locked private frame,
+   anonymous if it came from a file but has been written since:
+   its data no longer matches the file, so from now on it belongs
+   in swap.  Called before P's frame is shared, because sharing
+   maps it read-only and the dirty bit stops telling. */
+void
+page_detach_file (struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->frame->file == NULL);
+
+  if (p->file != NULL && pagedir_is_dirty (p->thread->pagedir, p->addr))
+    {
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+    }
+}
+
+/** Makes the current process's page table a copy of PARENT's,
+   which must not change meanwhile.  PARENT's resident private
+   frames are shared copy-on-write rather than copied, and its
+   swap slots are shared too.  TRANSLATE maps each file that
+   PARENT's pages refer to onto the current process's handle for
+   the same file, given AUX.
+   Returns true if successful, false if memory is exhausted. */
+bool
+page_fork (struct thread *parent,
+           struct file *(*translate) (struct file *, void *aux), void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct hash_iterator i;
+  size_t share_cnt = 0;
+  bool success = true;
+
+  hash_first (&i, parent->pages);
+  while (success && hash_next (&i))
+    {
+      struct page *pp = hash_entry (hash_cur (&i), struct page, hash_elem);
+      struct page *cp = page_allocate (pp->addr, pp->read_only);
+      struct frame *f;
+
+      if (cp == NULL)
+        return false;
+
+      frame_lock (pp);
+      cp->private = pp->private;
+      f = pp->frame;
+      if (f != NULL && f->file == NULL)
+        page_detach_file (pp);
+      if (pp->file != NULL)
+        {
+          cp->file = translate (pp->file, aux);
+          cp->file_offset = pp->file_offset;
+          cp->file_bytes = pp->file_bytes;
+        }
+      if (pp->sector != (block_sector_t) -1)
+        swap_copy (cp, pp);
+      if (f == NULL && page_is_zero_mapped (pp))
+        success = map_zero_page (cp);
+
+      if (f != NULL)
+        {
+          /* Share the frame, read-only unless it is a page cache
+             frame, which is shared anyway. */
+          list_push_back (&f->pages, &cp->frame_elem);
+          cp->frame = f;
+          if (f->file == NULL)
+            {
+              pagedir_set_writable (parent->pagedir, pp->addr, false);
+              share_cnt++;
+            }
+          success = pagedir_set_page (cur->pagedir, cp->addr, f->base,
+                                      page_writable (cp));
+          frame_unlock (f);
+        }
+    }
+
+  lock_acquire (&stats_lock);
+  fork_cnt++;
+  cow_share_cnt += share_cnt;
+  lock_release (&stats_lock);
+  return success;
+}
+
+/** Adds a mapping for user virtual address VADDR to the page hash
+   table.  Fails if VADDR is already mapped or if memory
+   allocation fails. */
+struct page *
+page_allocate (void *vaddr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+
+      p->read_only = read_only;
+      p->private = true;
+
+      p->frame = NULL;
+      p->referenced = false;
+
+      p->sector = (block_sector_t) -1;
+
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+
+      p->thread = thread_current ();
+
+      if (hash_insert (t->pages, &p->hash_elem) != NULL)
+        {
+          /* Already mapped. */
+          free (p);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/** Evicts the page containing address VADDR
+   and removes it from the page table. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page *p = page_for_addr (vaddr);
+  ASSERT (p != NULL);
+  frame_lock (p);
+  if (p->frame)
+    release_frame (p);
+  else
+    pagedir_clear_page (p->thread->pagedir, p->addr);
+  swap_free (p);
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  free (p);
+}
+
+/** Returns a hash value for the page that E refers to. */
+unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/** Returns true if page A precedes page B. */
+bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
@@ -0,0 +1,71 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/** Virtual page. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /**< User virtual address. */
+    bool read_only;             /**< Read-only page? */
+    struct thread *thread;      /**< Owning thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /**< struct thread `pages' hash element. */
+
+    /* Set only in owning process context with frame->lock held.
+       Cleared only with frame->lock held.  Moved to another frame
+       only by same-page merging, with both frames locked. */
+    struct frame *frame;        /**< Page frame. */
+    struct list_elem frame_elem; /**< struct frame `pages' list element. */
+
+    /* Set by the working-set sampler when it clears the page's
+       accessed bit, so that the clock still sees the reference.
+       Protected by frame->lock. */
+    bool referenced;            /**< Accessed since the clock last looked? */
+
+    /* Swap information, protected by frame->lock. */
+    block_sector_t sector;      /**< Starting sector of swap area, or -1. */
+
+    /* Memory-mapped file information, protected by frame->lock. */
+    bool private;               /**< False to write back to file,
+                                   true to write back to swap. */
+    struct file *file;          /**< File. */
+    off_t file_offset;          /**< Offset in file. */
+    off_t file_bytes;           /**< Bytes to read/write, 1...PGSIZE. */
+  };
+
+struct thread;
+struct file;
+struct memstat;
+
+extern bool page_exit_stats;
+extern size_t stack_limit;
+
+void page_init (void);
+void page_exit (void);
+void page_print_stats (void);
+void page_start_sampler (void);
+void page_get_stats (struct memstat *);
+
+struct page *page_allocate (void *, bool read_only);
+void page_deallocate (void *vaddr);
+
+bool page_in (void *fault_addr, bool write);
+bool page_out (struct frame *);
+bool page_accessed_recently (struct frame *);
+bool page_hot (struct frame *);
+bool page_unshare (void *fault_addr);
+void page_detach_file (struct page *);
+bool page_fork (struct thread *parent,
+                struct file *(*translate) (struct file *, void *aux),
+                void *aux);
+
+hash_hash_func page_hash;
+hash_less_func page_less;
+
+#endif /**< vm/page.h */
@@ -0,0 +1,281 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/zswap.h"
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/** Swap manager.
+
+   The swap device is divided into page-sized "slots" of
+   PAGE_SECTORS consecutive sectors each, tracked by a bitmap.
+
+   Eviction hands us a cluster of pages from neighbouring virtual
+   addresses at once.  We try to give them a single run of
+   adjacent slots, so that the whole cluster goes out in one
+   ascending burst of sector writes and so that a later swap-in
+   of one of them can cheaply read its neighbours ahead.
+
+   A slot may be shared by several pages, after fork() copies a
+   page that is in swap or evicts a frame that several processes
+   share copy-on-write, so each slot has a reference count.
+
+   With the -zswap option, pages pass through a compressed cache
+   in memory on their way to and from their slots (see
+   vm/zswap.c), so a slot's data need not ever reach the disk. */
+
+/** The swap device. */
+static struct block *swap_device;
+
+/** Used swap slots, one bit per page. */
+static struct bitmap *swap_bitmap;
+
+/** Number of pages referring to each swap slot. */
+static unsigned short *swap_refs;
+
+/** Protects swap_bitmap, swap_refs, and the statistics below. */
+static struct lock swap_lock;
+
+/** Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/** Statistics. */
+static unsigned long long pages_out;    /**< Pages written to swap. */
+static unsigned long long cluster_cnt;  /**< Swap-out bursts. */
+static unsigned long long split_cnt;    /**< Bursts that got no single run. */
+static unsigned long long pages_in;     /**< Pages read from swap. */
+static unsigned long long ahead_cnt;    /**< ...of which read ahead. */
+
+static bool allocate_slots (size_t slots[], size_t page_cnt);
+
+/** Sets up swap. */
+void
+swap_init (void)
+{
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("no swap device--swap disabled\n");
+      swap_bitmap = bitmap_create (0);
+    }
+  else
+    swap_bitmap = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  swap_refs = calloc (bitmap_size (swap_bitmap) + 1, sizeof *swap_refs);
+  if (swap_refs == NULL)
+    PANIC ("couldn't create swap reference counts");
+  lock_init (&swap_lock);
+  zswap_init (swap_device, bitmap_size (swap_bitmap));
+}
+
+/** Writes the PAGE_CNT pages in PAGES out to swap, in order, and
+   records the swap location in each page.  Each page must have a
+   frame, locked by the caller.
+   The pages go to adjacent slots if such a run is free, otherwise
+   each to a slot of its own.  Returns true if successful, false
+   if swap is too full, in which case no page is swapped out. */
+bool
+swap_out (struct page *pages[], size_t page_cnt)
+{
+  size_t slots[SWAP_CLUSTER];
+  size_t i, j;
+
+  ASSERT (page_cnt > 0 && page_cnt <= SWAP_CLUSTER);
+
+  if (!allocate_slots (slots, page_cnt))
+    return false;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      struct page *p = pages[i];
+
+      ASSERT (p->frame != NULL);
+      ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+      p->sector = slots[i] * PAGE_SECTORS;
+      if (!zswap_store (slots[i], p->frame->base))
+        for (j = 0; j < PAGE_SECTORS; j++)
+          block_write (swap_device, p->sector + j,
+                       (uint8_t *) p->frame->base + j * BLOCK_SECTOR_SIZE);
+
+      /* The page now lives in swap; it no longer has anything to
+         do with the file it may originally have come from. */
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+    }
+
+  lock_acquire (&swap_lock);
+  pages_out += page_cnt;
+  cluster_cnt++;
+  lock_release (&swap_lock);
+
+  return true;
+}
+
+/** Writes frame F, which the caller must have locked, out to a
+   single swap slot shared by all the pages mapped to it, and
+   records the swap location in each page.  Returns true if
+   successful, false if swap is full. */
+bool
+swap_out_frame (struct frame *f)
+{
+  struct list_elem *e;
+  size_t slot, i;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  if (!allocate_slots (&slot, 1))
+    return false;
+
+  if (!zswap_store (slot, f->base))
+    for (i = 0; i < PAGE_SECTORS; i++)
+      block_write (swap_device, slot * PAGE_SECTORS + i,
+                   (uint8_t *) f->base + i * BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&swap_lock);
+  swap_refs[slot] = list_size (&f->pages);
+  pages_out++;
+  cluster_cnt++;
+  lock_release (&swap_lock);
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      p->sector = slot * PAGE_SECTORS;
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+    }
+
+  return true;
+}
+
+/** Reads page P's contents from swap into its frame, which the
+   caller must have locked, and releases its swap slot.
+   READ_AHEAD is true if no one has faulted on P yet. */
+void
+swap_in (struct page *p, bool read_ahead)
+{
+  size_t i;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->sector != (block_sector_t) -1);
+
+  if (!zswap_load (p->sector / PAGE_SECTORS, p->frame->base))
+    for (i = 0; i < PAGE_SECTORS; i++)
+      block_read (swap_device, p->sector + i,
+                  (uint8_t *) p->frame->base + i * BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&swap_lock);
+  pages_in++;
+  if (read_ahead)
+    ahead_cnt++;
+  lock_release (&swap_lock);
+
+  swap_free (p);
+}
+
+/** Makes page DST refer to the same swap slot as page SRC, which
+   must be in swap. */
+void
+swap_copy (struct page *dst, const struct page *src)
+{
+  ASSERT (src->sector != (block_sector_t) -1);
+
+  lock_acquire (&swap_lock);
+  swap_refs[src->sector / PAGE_SECTORS]++;
+  lock_release (&swap_lock);
+  dst->sector = src->sector;
+}
+
+/** Releases page P's reference to its swap slot, if it has one.
+   The slot is freed once no page refers to it. */
+void
+swap_free (struct page *p)
+{
+  size_t slot;
+  bool last;
+
+  if (p->sector == (block_sector_t) -1)
+    return;
+
+  slot = p->sector / PAGE_SECTORS;
+  lock_acquire (&swap_lock);
+  ASSERT (swap_refs[slot] > 0);
+  last = --swap_refs[slot] == 0;
+  lock_release (&swap_lock);
+  p->sector = (block_sector_t) -1;
+
+  if (last)
+    {
+      /* Nobody can allocate or copy the slot until we reset its
+         bit, so drop any cached copy before that. */
+      zswap_invalidate (slot);
+      lock_acquire (&swap_lock);
+      bitmap_reset (swap_bitmap, slot);
+      lock_release (&swap_lock);
+    }
+}
+
+/** Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %llu pages out in %llu clusters (%llu split), "
+          "%llu pages in (%llu read ahead)\n",
+          pages_out, cluster_cnt, split_cnt, pages_in, ahead_cnt);
+}
+
+/** Allocates PAGE_CNT swap slots, consecutive if possible, and
+   stores them into SLOTS[].  Returns true if successful, false
+   if swap does not have PAGE_CNT free slots. */
+static bool
+allocate_slots (size_t slots[], size_t page_cnt)
+{
+  size_t first, i;
+  bool success = true;
+
+  lock_acquire (&swap_lock);
+  first = bitmap_scan_and_flip (swap_bitmap, 0, page_cnt, false);
+  if (first != BITMAP_ERROR)
+    {
+      for (i = 0; i < page_cnt; i++)
+        {
+          slots[i] = first + i;
+          swap_refs[slots[i]] = 1;
+        }
+    }
+  else
+    {
+      /* No run long enough.  Scatter the cluster instead. */
+      for (i = 0; i < page_cnt; i++)
+        {
+          slots[i] = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
+          if (slots[i] == BITMAP_ERROR)
+            {
+              while (i-- > 0)
+                {
+                  bitmap_reset (swap_bitmap, slots[i]);
+                  swap_refs[slots[i]] = 0;
+                }
+              success = false;
+              break;
+            }
+          swap_refs[slots[i]] = 1;
+        }
+      if (success && page_cnt > 1)
+        split_cnt++;
+    }
+  lock_release (&swap_lock);
+
+  return success;
+}
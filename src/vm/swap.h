@@ -0,0 +1,24 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+struct page;
+
+/** Maximum number of pages written to swap in one cluster. */
+#define SWAP_CLUSTER 8
+
+/** Number of neighbouring swap slots read ahead on a swap-in. */
+#define SWAP_READ_AHEAD 3
+
+void swap_init (void);
+bool swap_out (struct page *pages[], size_t page_cnt);
+bool swap_out_frame (struct frame *);
+void swap_in (struct page *, bool read_ahead);
+void swap_copy (struct page *dst, const struct page *src);
+void swap_free (struct page *);
+void swap_print_stats (void);
+
+#endif /**< vm/swap.h */
@@ -0,0 +1,518 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/** Compressed swap cache.
+
+   This sits between the swap manager and the swap device.  A page
+   on its way to a swap slot is compressed, and if it shrinks
+   enough it is kept in a pool of kernel pages instead of being
+   written to disk.  Only when the pool fills up are the least
+   recently stored pages decompressed again and written out to
+   their slots.  A page of all zeros takes no pool space at all,
+   just a bit in `zero_slots'.
+
+   Entries are indexed by swap slot, so the swap manager goes on
+   allocating and reference-counting slots just as before.  The
+   only difference is that a slot's data might not be on disk.
+
+   The compressor is a small byte-oriented LZ77 in the style of
+   LZ4.  The compressed data is a series of sequences.  Each
+   sequence is a token byte whose high nibble is the number of
+   literal bytes that follow and whose low nibble is the length
+   of a match, minus MIN_MATCH, that comes after the literals.
+   A nibble of 15 means that the length continues in extra bytes
+   that are added to it, up to and including the first byte that
+   is not 255.  The literals come next, then the match's offset
+   as 2 little-endian bytes, then the match length's extra bytes.
+   A page always decompresses to PGSIZE bytes, so decompression
+   stops as soon as the page is full.  The last sequence may end
+   with a match that reaches the end of the page, or its literals
+   may reach it, in which case the sequence has no offset and no
+   match.
+
+   Spilling a page to disk takes 8 sector writes, which happen
+   without holding `zswap_lock', so that other threads can store
+   and load pages meanwhile.  The entry stays in `entries', marked
+   as spilling, until the writes finish, and zswap_load() and
+   zswap_invalidate() wait for that before going to the disk or
+   freeing the slot. */
+
+/** -zswap: Size of the pool in pages, or 0 to disable it. */
+size_t zswap_pages;
+
+/** Pool space is handed out in chunks of this many bytes. */
+#define CHUNK_SIZE 32
+
+/** A page that compresses to more than this many bytes is not
+   worth keeping, so it goes straight to disk. */
+#define MAX_COMPRESSED (PGSIZE * 3 / 4)
+
+/** A compressed page in the pool. */
+struct entry
+  {
+    size_t slot;                /**< Swap slot. */
+    size_t chunk;               /**< First pool chunk. */
+    size_t size;                /**< Compressed size in bytes. */
+    bool spilling;              /**< Being written to disk? */
+    struct list_elem lru_elem;  /**< `lru' list element, unless
+                                   spilling. */
+  };
+
+/** The swap device, to which full pools spill. */
+static struct block *swap_device;
+
+/** The pool, or a null pointer if the cache is disabled. */
+static uint8_t *pool;
+
+/** Chunks of `pool' in use. */
+static struct bitmap *used_chunks;
+
+/** Pool entry for each swap slot, or a null pointer. */
+static struct entry **entries;
+
+/** Swap slots holding a page of zeros. */
+static struct bitmap *zero_slots;
+
+/** Entries, most recently used first. */
+static struct list lru;
+
+/** Compression output. */
+static uint8_t zbuf[MAX_COMPRESSED];
+
+/** Protects everything above, plus the compressor's hash table
+   and the statistics below. */
+static struct lock zswap_lock;
+
+/** Signaled when a spill finishes. */
+static struct condition spilled;
+
+/** The page that spilled entries are decompressed into before
+   being written out, and the lock that protects it. */
+static void *spill_page;
+static struct lock spill_lock;
+
+/** Statistics. */
+static unsigned long long stored_cnt;   /**< Pages compressed into the pool. */
+static unsigned long long stored_bytes; /**< ...and their compressed size. */
+static unsigned long long zero_cnt;     /**< Zero pages stored as a flag. */
+static unsigned long long reject_cnt;   /**< Pages that did not compress. */
+static unsigned long long hit_cnt;      /**< Pages read back from memory. */
+static unsigned long long spill_cnt;    /**< Pages spilled to disk. */
+
+/** Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static size_t compress (const uint8_t *src, uint8_t *dst, size_t dst_size);
+static void decompress (const uint8_t *src, uint8_t *dst);
+static bool is_zero_page (const void *);
+static void spill (struct entry *);
+static void remove_entry (struct entry *);
+
+/** Sets up the compressed swap cache in front of DEVICE,
+   which has SLOT_CNT page-sized slots, if the -zswap option asked
+   for one. */
+void
+zswap_init (struct block *device, size_t slot_cnt)
+{
+  if (zswap_pages == 0 || slot_cnt == 0)
+    return;
+
+  pool = palloc_get_multiple (0, zswap_pages);
+  if (pool == NULL)
+    {
+      printf ("couldn't allocate %zu-page compressed swap pool"
+              "--compressed swap disabled\n", zswap_pages);
+      return;
+    }
+
+  swap_device = device;
+  used_chunks = bitmap_create (zswap_pages * (PGSIZE / CHUNK_SIZE));
+  entries = calloc (slot_cnt, sizeof *entries);
+  zero_slots = bitmap_create (slot_cnt);
+  spill_page = palloc_get_page (0);
+  if (used_chunks == NULL || entries == NULL || zero_slots == NULL
+      || spill_page == NULL)
+    PANIC ("couldn't set up compressed swap");
+  list_init (&lru);
+  lock_init (&zswap_lock);
+  cond_init (&spilled);
+  lock_init (&spill_lock);
+}
+
+/** Tries to keep PAGE, the data bound for swap slot SLOT, in
+   memory, spilling older pages to disk if necessary to make room.
+   Returns true if successful, false if the cache is disabled or
+   PAGE does not compress well, in which case the caller must
+   write PAGE to disk itself. */
+bool
+zswap_store (size_t slot, const void *page)
+{
+  struct entry *e;
+  size_t size, chunk_cnt, chunk;
+
+  if (pool == NULL)
+    return false;
+
+  if (is_zero_page (page))
+    {
+      lock_acquire (&zswap_lock);
+      bitmap_mark (zero_slots, slot);
+      zero_cnt++;
+      lock_release (&zswap_lock);
+      return true;
+    }
+
+  e = malloc (sizeof *e);
+  if (e == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  ASSERT (entries[slot] == NULL);
+  for (;;)
+    {
+      /* Compress again each time around, because another thread
+         may have used `zbuf' while we were spilling. */
+      size = compress (page, zbuf, sizeof zbuf);
+      chunk_cnt = DIV_ROUND_UP (size, CHUNK_SIZE);
+      if (size == 0 || chunk_cnt > bitmap_size (used_chunks))
+        {
+          reject_cnt++;
+          lock_release (&zswap_lock);
+          free (e);
+          return false;
+        }
+
+      chunk = bitmap_scan_and_flip (used_chunks, 0, chunk_cnt, false);
+      if (chunk != BITMAP_ERROR)
+        break;
+
+      /* Make room by spilling the least recently used page, or
+         wait for other threads' spills to free some. */
+      if (!list_empty (&lru))
+        spill (list_entry (list_back (&lru), struct entry, lru_elem));
+      else
+        cond_wait (&spilled, &zswap_lock);
+    }
+
+  memcpy (pool + chunk * CHUNK_SIZE, zbuf, size);
+  e->slot = slot;
+  e->chunk = chunk;
+  e->size = size;
+  e->spilling = false;
+  entries[slot] = e;
+  list_push_front (&lru, &e->lru_elem);
+  stored_cnt++;
+  stored_bytes += size;
+  lock_release (&zswap_lock);
+
+  return true;
+}
+
+/** Reads the page stored for swap slot SLOT into PAGE, if it is
+   in memory.  Returns true if successful, false if the caller
+   must read it from disk instead.  The slot keeps its data until
+   zswap_invalidate() is called, because other pages may share
+   it. */
+bool
+zswap_load (size_t slot, void *page)
+{
+  struct entry *e;
+  bool found = true;
+
+  if (pool == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  while ((e = entries[slot]) != NULL && e->spilling)
+    cond_wait (&spilled, &zswap_lock);
+  if (bitmap_test (zero_slots, slot))
+    memset (page, 0, PGSIZE);
+  else if (e != NULL)
+    {
+      decompress (pool + e->chunk * CHUNK_SIZE, page);
+      list_remove (&e->lru_elem);
+      list_push_front (&lru, &e->lru_elem);
+    }
+  else
+    found = false;
+  if (found)
+    hit_cnt++;
+  lock_release (&zswap_lock);
+
+  return found;
+}
+
+/** Discards whatever is stored in memory for swap slot SLOT, which
+   has just been freed. */
+void
+zswap_invalidate (size_t slot)
+{
+  if (pool == NULL)
+    return;
+
+  lock_acquire (&zswap_lock);
+  while (entries[slot] != NULL && entries[slot]->spilling)
+    cond_wait (&spilled, &zswap_lock);
+  bitmap_reset (zero_slots, slot);
+  if (entries[slot] != NULL)
+    remove_entry (entries[slot]);
+  lock_release (&zswap_lock);
+}
+
+/** Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  unsigned long long ratio;
+
+  if (pool == NULL)
+    return;
+
+  /* Hundredths of the ratio of original to compressed size. */
+  ratio = stored_bytes > 0 ? stored_cnt * PGSIZE * 100 / stored_bytes : 0;
+  printf ("Compressed swap: %llu pages stored (ratio %llu.%02llu:1), "
+          "%llu zero, %llu incompressible, %llu pool hits, "
+          "%llu spilled, %llu disk writes avoided\n",
+          stored_cnt, ratio / 100, ratio % 100, zero_cnt, reject_cnt,
+          hit_cnt, spill_cnt, stored_cnt + zero_cnt - spill_cnt);
+}
+
+/** Returns true if PAGE contains nothing but zeros. */
+static bool
+is_zero_page (const void *page)
+{
+  const uint32_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+/** Writes entry E's page out to its swap slot and removes it from
+   the pool.  Releases `zswap_lock' during the writes. */
+static void
+spill (struct entry *e)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&zswap_lock));
+  ASSERT (!e->spilling);
+
+  /* No one else spills E, frees it, or reuses its chunks while it
+     is marked spilling, so its compressed data stay put. */
+  e->spilling = true;
+  list_remove (&e->lru_elem);
+  lock_release (&zswap_lock);
+
+  lock_acquire (&spill_lock);
+  decompress (pool + e->chunk * CHUNK_SIZE, spill_page);
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, e->slot * PAGE_SECTORS + i,
+                 (uint8_t *) spill_page + i * BLOCK_SECTOR_SIZE);
+  lock_release (&spill_lock);
+
+  lock_acquire (&zswap_lock);
+  spill_cnt++;
+  remove_entry (e);
+  cond_broadcast (&spilled, &zswap_lock);
+}
+
+/** Frees entry E and its pool space. */
+static void
+remove_entry (struct entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&zswap_lock));
+
+  bitmap_set_multiple (used_chunks, e->chunk,
+                       DIV_ROUND_UP (e->size, CHUNK_SIZE), false);
+  if (!e->spilling)
+    list_remove (&e->lru_elem);
+  entries[e->slot] = NULL;
+  free (e);
+}
+
+/** Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/** The compressor finds matches through a hash table of the most
+   recent page offset at which each 4-byte sequence began.  Stale
+   entries, left over from earlier pages, are harmless because
+   every candidate match is checked byte by byte. */
+#define HASH_BITS 12
+static uint16_t hash_table[1 << HASH_BITS];
+
+/** Returns the 4 bytes at P as an integer. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/** Returns the hash table index for the 4 bytes X. */
+static inline unsigned
+hash_seq (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/** Writes the extra bytes for LEN, the part of a length beyond
+   what fits in a token nibble, to OP.  Returns the new OP. */
+static uint8_t *
+put_length (uint8_t *op, size_t len)
+{
+  for (; len >= 255; len -= 255)
+    *op++ = 255;
+  *op++ = len;
+  return op;
+}
+
+/** Reads the extra bytes of a length from *IP and advances *IP
+   past them.  Returns the value they encode. */
+static size_t
+get_length (const uint8_t **ip)
+{
+  size_t len = 0;
+  uint8_t b;
+
+  do
+    {
+      b = *(*ip)++;
+      len += b;
+    }
+  while (b == 255);
+  return len;
+}
+
+/** Appends a sequence to OP, which may not grow past OP_END: the
+   LIT_CNT literal bytes at LIT, then, if MATCH_LEN is nonzero, a
+   MATCH_LEN-byte copy from OFFSET bytes back.  Returns the new
+   OP, or a null pointer if the sequence does not fit. */
+static uint8_t *
+put_sequence (uint8_t *op, const uint8_t *op_end,
+              const uint8_t *lit, size_t lit_cnt,
+              size_t offset, size_t match_len)
+{
+  size_t match_code = match_len > 0 ? match_len - MIN_MATCH : 0;
+  uint8_t *token;
+
+  /* Token, literal length, literals, offset, match length. */
+  if ((size_t) (op_end - op)
+      < 1 + (lit_cnt / 255 + 1) + lit_cnt + 2 + (match_code / 255 + 1))
+    return NULL;
+
+  token = op++;
+  *token = (lit_cnt < 15 ? lit_cnt : 15) << 4;
+  if (lit_cnt >= 15)
+    op = put_length (op, lit_cnt - 15);
+  memcpy (op, lit, lit_cnt);
+  op += lit_cnt;
+
+  if (match_len > 0)
+    {
+      *op++ = offset & 0xff;
+      *op++ = offset >> 8;
+      *token |= match_code < 15 ? match_code : 15;
+      if (match_code >= 15)
+        op = put_length (op, match_code - 15);
+    }
+  return op;
+}
+
+/** Compresses the page at SRC into the DST_SIZE bytes at DST.
+   Returns the compressed size, or 0 if it would exceed
+   DST_SIZE. */
+static size_t
+compress (const uint8_t *src, uint8_t *dst, size_t dst_size)
+{
+  const uint8_t *end = src + PGSIZE;
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  uint8_t *op = dst;
+
+  while (ip + MIN_MATCH <= end)
+    {
+      uint32_t seq = read32 (ip);
+      unsigned h = hash_seq (seq);
+      const uint8_t *ref = src + hash_table[h];
+      size_t len;
+
+      hash_table[h] = ip - src;
+      if (ref >= ip || read32 (ref) != seq)
+        {
+          ip++;
+          continue;
+        }
+
+      for (len = MIN_MATCH; ip + len < end && ip[len] == ref[len]; len++)
+        continue;
+      op = put_sequence (op, dst + dst_size, anchor, ip - anchor,
+                         ip - ref, len);
+      if (op == NULL)
+        return 0;
+      ip += len;
+      anchor = ip;
+    }
+
+  if (anchor < end)
+    {
+      op = put_sequence (op, dst + dst_size, anchor, end - anchor, 0, 0);
+      if (op == NULL)
+        return 0;
+    }
+  return op - dst;
+}
+
+/** Decompresses the page compressed at SRC into DST. */
+static void
+decompress (const uint8_t *src, uint8_t *dst)
+{
+  const uint8_t *ip = src;
+  uint8_t *op = dst;
+  uint8_t *end = dst + PGSIZE;
+
+  while (op < end)
+    {
+      unsigned token = *ip++;
+      size_t lit_cnt = token >> 4;
+      size_t match_len = token & 15;
+      size_t offset;
+      const uint8_t *ref;
+
+      if (lit_cnt == 15)
+        lit_cnt += get_length (&ip);
+      ASSERT (lit_cnt <= (size_t) (end - op));
+      memcpy (op, ip, lit_cnt);
+      op += lit_cnt;
+      ip += lit_cnt;
+      if (op == end)
+        break;
+
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (match_len == 15)
+        match_len += get_length (&ip);
+      match_len += MIN_MATCH;
+      ASSERT (offset > 0 && offset <= (size_t) (op - dst));
+      ASSERT (match_len <= (size_t) (end - op));
+
+      /* The source may overlap the destination, so copy byte by
+         byte. */
+      for (ref = op - offset; match_len > 0; match_len--)
+        *op++ = *ref++;
+    }
+}
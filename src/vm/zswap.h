@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct block;
+
+extern size_t zswap_pages;
+
+void zswap_init (struct block *device, size_t slot_cnt);
+bool zswap_store (size_t slot, const void *page);
+bool zswap_load (size_t slot, void *page);
+void zswap_invalidate (size_t slot);
+void zswap_print_stats (void);
+
+#endif /**< vm/zswap.h */